@@ -27,6 +27,7 @@ class BlockchainTest(TcoinTestFramework):
     Test blockchain-related RPC calls:
 
         - gettxoutsetinfo
+        - scantxoutset
         - verifychain
 
     """
@@ -44,6 +45,7 @@ class BlockchainTest(TcoinTestFramework):
 
     def run_test(self):
         self._test_gettxoutsetinfo()
+        self._test_scantxoutset()
         self._test_getblockheader()
         self.nodes[0].verifychain(4, 0)
 
@@ -52,12 +54,50 @@ class BlockchainTest(TcoinTestFramework):
         res = node.gettxoutsetinfo()
 
         assert_equal(res['total_amount'], Decimal('8725.00000000'))
-        assert_equal(res['transactions'], 200)
         assert_equal(res['height'], 200)
         assert_equal(res['txouts'], 200)
-        assert_equal(res['bytes_serialized'], 13924),
         assert_equal(len(res['bestblock']), 64)
-        assert_equal(len(res['hash_serialized']), 64)
+        assert_equal(len(res['muhash']), 64)
+        assert('hash_serialized' not in res)
+
+        # The full scan agrees with the rolling commitment
+        res2 = node.gettxoutsetinfo('hash_serialized')
+        assert_equal(res2['total_amount'], res['total_amount'])
+        assert_equal(res2['height'], res['height'])
+        assert_equal(res2['txouts'], res['txouts'])
+        assert_equal(res2['bestblock'], res['bestblock'])
+        assert_equal(res2['muhash'], res['muhash'])
+        assert_equal(res2['transactions'], 200)
+        assert_equal(res2['bytes_serialized'], 13924),
+        assert_equal(len(res2['hash_serialized']), 64)
+        assert_raises(JSONRPCException, node.gettxoutsetinfo, 'nonsense')
+
+    def _test_scantxoutset(self):
+        node = self.nodes[0]
+        coinbase = node.getblock(node.getblockhash(1))['tx'][0]
+        txout = node.gettxout(coinbase, 0)
+        script = txout['scriptPubKey']
+        expected = {'txid': coinbase, 'vout': 0, 'scriptPubKey': script['hex'], 'amount': txout['value'], 'height': 1}
+
+        res = node.scantxoutset('start', [{'script': script['hex']}])
+        assert_equal(res['success'], True)
+        assert_equal(res['searched_items'], 200)
+        assert_equal(res['height'], 200)
+        assert_equal(res['bestblock'], node.getbestblockhash())
+        assert_equal(res['unspents'], [expected])
+        assert_equal(res['total_amount'], txout['value'])
+
+        # Duplicate targets and addresses match the same outputs
+        res = node.scantxoutset('start', [script['addresses'][0], {'script': script['hex']}])
+        assert_equal(res['unspents'], [expected])
+        assert_equal(node.scantxoutset('start', [])['unspents'], [])
+
+        # Nothing to report or abort when no scan is running
+        assert_equal(node.scantxoutset('status'), None)
+        assert_equal(node.scantxoutset('abort'), False)
+        assert_raises(JSONRPCException, node.scantxoutset, 'start')
+        assert_raises(JSONRPCException, node.scantxoutset, 'start', ['nonsense'])
+        assert_raises(JSONRPCException, node.scantxoutset, 'nonsense')
 
     def _test_getblockheader(self):
         node = self.nodes[0]
@@ -47,8 +47,9 @@ namespace benchmark {
         uint64_t lastCycles;
         uint64_t minCycles;
         uint64_t maxCycles;
+        uint64_t bytesPerIteration;
     public:
-        State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0) {
+        State(std::string _name, double _maxElapsed) : name(_name), maxElapsed(_maxElapsed), count(0), bytesPerIteration(0) {
             minTime = std::numeric_limits<double>::max();
             maxTime = std::numeric_limits<double>::min();
             minCycles = std::numeric_limits<uint64_t>::max();
@@ -57,6 +58,9 @@ namespace benchmark {
             countMaskInv = 1./(countMask + 1);
         }
         bool KeepRunning();
+        /** Declare how many input bytes one iteration processes, so that
+         *  the result also reports cycles per byte. Call before the loop. */
+        void SetBytesPerIteration(uint64_t bytes) { bytesPerIteration = bytes; }
     };
 
     typedef boost::function<void(State&)> BenchFunction;
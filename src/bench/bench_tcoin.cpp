@@ -4,6 +4,8 @@
 
 #include "bench.h"
 
+#include "crypto/sha256.h"
+#include "crypto/x17.h"
 #include "key.h"
 #include "validation.h"
 #include "util.h"
@@ -11,6 +13,8 @@
 int
 main(int argc, char** argv)
 {
+    X17AutoDetect();
+    SHA256AutoDetect();
     ECC_Start();
     SetupEnvironment();
     fPrintToDebugLog = false; // don't want to write to debug.log file
@@ -4,6 +4,7 @@
 
 #include "bench.h"
 #include "key.h"
+#include "random.h"
 #if defined(HAVE_CONSENSUS_LIB)
 #include "script/tcoinconsensus.h"
 #endif
@@ -99,4 +100,50 @@ static void VerifyScriptBench(benchmark::State& state)
     }
 }
 
+// Microbenchmark for the stack machine alone: pushes, duplications, hashes
+// and drops over signature- and pubkey-sized elements, without any
+// signature check.
+static void VerifyStackOpsBench(benchmark::State& state)
+{
+    const int flags = SCRIPT_VERIFY_P2SH;
+
+    CScript scriptSig = CScript() << std::vector<unsigned char>(72, 0x30) << std::vector<unsigned char>(33, 0x02);
+    CScript scriptPubKey;
+    for (int i = 0; i < 30; i++)
+        scriptPubKey << OP_DUP << OP_HASH160 << OP_DROP << OP_2DUP << OP_2DROP;
+    scriptPubKey << OP_2DROP << OP_TRUE;
+
+    while (state.KeepRunning()) {
+        ScriptError err;
+        bool success = VerifyScript(scriptSig, scriptPubKey, NULL, flags, BaseSignatureChecker(), &err);
+        assert(err == SCRIPT_ERR_OK);
+        assert(success);
+    }
+}
+
+// Legacy SIGHASH_ALL hashes for every input of a 200-input sweep, the
+// pattern that makes such transactions quadratic to validate.
+static void SignatureHashLegacyBench(benchmark::State& state)
+{
+    CMutableTransaction txSweep;
+    txSweep.vin.resize(200);
+    for (unsigned int i = 0; i < txSweep.vin.size(); i++) {
+        txSweep.vin[i].prevout = COutPoint(GetRandHash(), i);
+        txSweep.vin[i].scriptSig = CScript() << std::vector<unsigned char>(72) << std::vector<unsigned char>(33);
+    }
+    txSweep.vout.resize(1);
+    txSweep.vout[0].scriptPubKey = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20) << OP_EQUALVERIFY << OP_CHECKSIG;
+    const CTransaction tx(txSweep);
+    const CScript& scriptCode = tx.vout[0].scriptPubKey;
+
+    while (state.KeepRunning()) {
+        PrecomputedTransactionData txdata(tx);
+        for (unsigned int i = 0; i < tx.vin.size(); i++) {
+            SignatureHash(scriptCode, tx, i, SIGHASH_ALL, 0, SIGVERSION_BASE, &txdata);
+        }
+    }
+}
+
 BENCHMARK(VerifyScriptBench);
+BENCHMARK(VerifyStackOpsBench);
+BENCHMARK(SignatureHashLegacyBench);
@@ -0,0 +1,106 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "uint256.h"
+#include "crypto/x17.h"
+
+#include <vector>
+
+template<typename Ctx, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+static void X17Stage(benchmark::State& state)
+{
+    uint512 buf;
+    state.SetBytesPerIteration(X17_STAGE_SIZE);
+    while (state.KeepRunning()) {
+        Ctx ctx;
+        Init(&ctx);
+        Update(&ctx, buf.begin(), X17_STAGE_SIZE);
+        Close(&ctx, buf.begin());
+    }
+}
+
+/* The stages with an optional accelerated implementation, as used by HashX17 */
+template<void (*Transform)(unsigned char*, const unsigned char*)>
+static void X17StageAuto(benchmark::State& state)
+{
+    uint512 in, out;
+    // Two hashes per iteration.
+    state.SetBytesPerIteration(2 * X17_STAGE_SIZE);
+    while (state.KeepRunning()) {
+        Transform(out.begin(), in.begin());
+        Transform(in.begin(), out.begin());
+    }
+}
+
+static void X17Header(benchmark::State& state)
+{
+    CBlockHeader header;
+    state.SetBytesPerIteration(X17_HEADER_SIZE);
+    while (state.KeepRunning()) {
+        header.hashPrevBlock = header.GetPoWHash();
+    }
+}
+
+static void X17HeaderBatch(benchmark::State& state, size_t n)
+{
+    std::vector<unsigned char> in(n * X17_HEADER_SIZE), out(n * X17_OUTPUT_SIZE);
+    state.SetBytesPerIteration(in.size());
+    while (state.KeepRunning()) {
+        X17HashHeaders(out.data(), in.data(), n);
+        in[0] = out[0];
+    }
+}
+
+static void X17HeaderBatch_4(benchmark::State& state) { X17HeaderBatch(state, 4); }
+static void X17HeaderBatch_1000(benchmark::State& state) { X17HeaderBatch(state, 1000); }
+
+static void X17HeaderBatch_GetPoWHashes(benchmark::State& state)
+{
+    std::vector<CBlockHeader> headers(1000);
+    state.SetBytesPerIteration(headers.size() * X17_HEADER_SIZE);
+    while (state.KeepRunning()) {
+        std::vector<uint256> hashes = GetPoWHashes(headers);
+        headers[0].hashPrevBlock = hashes[0];
+    }
+}
+
+#define X17_STAGE(n, name, ctx, prefix) \
+    static void X17Stage##n##_##name(benchmark::State& state) { X17Stage<ctx, prefix##_init, prefix, prefix##_close>(state); } \
+    BENCHMARK(X17Stage##n##_##name);
+
+X17_STAGE(01, Blake512, sph_blake512_context, sph_blake512)
+X17_STAGE(02, Bmw512, sph_bmw512_context, sph_bmw512)
+X17_STAGE(03, Groestl512, sph_groestl512_context, sph_groestl512)
+X17_STAGE(04, Skein512, sph_skein512_context, sph_skein512)
+X17_STAGE(05, Jh512, sph_jh512_context, sph_jh512)
+X17_STAGE(06, Keccak512, sph_keccak512_context, sph_keccak512)
+X17_STAGE(07, Luffa512, sph_luffa512_context, sph_luffa512)
+X17_STAGE(08, Cubehash512, sph_cubehash512_context, sph_cubehash512)
+X17_STAGE(09, Shavite512, sph_shavite512_context, sph_shavite512)
+X17_STAGE(10, Simd512, sph_simd512_context, sph_simd512)
+X17_STAGE(11, Echo512, sph_echo512_context, sph_echo512)
+X17_STAGE(12, Hamsi512, sph_hamsi512_context, sph_hamsi512)
+X17_STAGE(13, Fugue512, sph_fugue512_context, sph_fugue512)
+X17_STAGE(14, Shabal512, sph_shabal512_context, sph_shabal512)
+X17_STAGE(15, Whirlpool, sph_whirlpool_context, sph_whirlpool)
+X17_STAGE(16, Sha512, sph_sha512_context, sph_sha512)
+X17_STAGE(17, Haval256_5, sph_haval256_5_context, sph_haval256_5)
+
+#undef X17_STAGE
+
+static void X17Stage03_Groestl512_Auto(benchmark::State& state) { X17StageAuto<X17Groestl512_64>(state); }
+static void X17Stage09_Shavite512_Auto(benchmark::State& state) { X17StageAuto<X17Shavite512_64>(state); }
+static void X17Stage11_Echo512_Auto(benchmark::State& state) { X17StageAuto<X17Echo512_64>(state); }
+
+BENCHMARK(X17Stage03_Groestl512_Auto);
+BENCHMARK(X17Stage09_Shavite512_Auto);
+BENCHMARK(X17Stage11_Echo512_Auto);
+
+BENCHMARK(X17Header);
+BENCHMARK(X17HeaderBatch_4);
+BENCHMARK(X17HeaderBatch_1000);
+BENCHMARK(X17HeaderBatch_GetPoWHashes);
@@ -0,0 +1,40 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "random.h"
+#include "streams.h"
+
+#include <vector>
+
+// Obfuscating values the size of a typical coin in the chainstate, at the
+// read position left after a one-byte header.
+static void XorSmall(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<unsigned char> key(8);
+    for (unsigned char& c : key)
+        c = rng.rand32();
+    CDataStream ds(std::vector<unsigned char>(41, 0x5a), 0, 0);
+    ds.ignore(1);
+    while (state.KeepRunning()) {
+        for (int i = 0; i < 1000; i++)
+            ds.Xor(key);
+    }
+}
+
+static void XorLarge(benchmark::State& state)
+{
+    FastRandomContext rng(true);
+    std::vector<unsigned char> key(8);
+    for (unsigned char& c : key)
+        c = rng.rand32();
+    CDataStream ds(std::vector<unsigned char>(1 << 20, 0x5a), 0, 0);
+    while (state.KeepRunning()) {
+        ds.Xor(key);
+    }
+}
+
+BENCHMARK(XorSmall);
+BENCHMARK(XorLarge);
@@ -0,0 +1,125 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TCOIN_CRYPTO_MUHASH_H
+#define TCOIN_CRYPTO_MUHASH_H
+
+#include "uint256.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/** A number in the multiplicative group modulo 2^3072 - 1103717. */
+class Num3072
+{
+private:
+    void FullReduce();
+    bool IsOverflow() const;
+    Num3072 GetInverse() const;
+
+public:
+    static constexpr size_t BYTE_SIZE = 384;
+
+#ifdef __SIZEOF_INT128__
+    typedef unsigned __int128 double_limb_t;
+    typedef uint64_t limb_t;
+    static constexpr int LIMBS = 48;
+    static constexpr int LIMB_SIZE = 64;
+#else
+    typedef uint64_t double_limb_t;
+    typedef uint32_t limb_t;
+    static constexpr int LIMBS = 96;
+    static constexpr int LIMB_SIZE = 32;
+#endif
+    limb_t limbs[LIMBS];
+
+    // Sanity check for Num3072 constants
+    static_assert(LIMB_SIZE * LIMBS == 3072, "Num3072 isn't 3072 bits");
+    static_assert(sizeof(double_limb_t) == sizeof(limb_t) * 2, "bad size for double_limb_t");
+    static_assert(sizeof(limb_t) * 8 == LIMB_SIZE, "LIMB_SIZE is incorrect");
+
+    Num3072() { SetToOne(); }
+    explicit Num3072(const unsigned char (&data)[BYTE_SIZE]);
+
+    void SetToOne();
+    void Multiply(const Num3072& a);
+    void Divide(const Num3072& a);
+    void ToBytes(unsigned char (&out)[BYTE_SIZE]) const;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        unsigned char data[BYTE_SIZE];
+        ToBytes(data);
+        s.write((char*)data, sizeof(data));
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        unsigned char data[BYTE_SIZE];
+        s.read((char*)data, sizeof(data));
+        *this = Num3072(data);
+    }
+};
+
+/**
+ * A hash of a multiset of byte strings (MuHash3072).
+ *
+ * Each element is hashed with SHA256, expanded to a 3072-bit number with
+ * ChaCha20 and multiplied into the set modulo a 3072-bit safe prime. The
+ * result does not depend on the order in which elements were added, and
+ * elements can be removed again by division. Numerator and denominator are
+ * kept apart so that the expensive modular inverse is only computed once,
+ * in Finalize().
+ *
+ * Adding the same element twice is allowed and counts it twice, so the
+ * caller is responsible for only removing what was added.
+ */
+class MuHash3072
+{
+private:
+    Num3072 numerator;
+    Num3072 denominator;
+
+    static Num3072 ToNum3072(const unsigned char* data, size_t len);
+
+public:
+    /* The empty set. */
+    MuHash3072() {}
+
+    /* A singleton with a single element. */
+    MuHash3072(const unsigned char* data, size_t len);
+
+    /* Insert a single element into the set. */
+    MuHash3072& Insert(const unsigned char* data, size_t len);
+
+    /* Remove a single element from the set. */
+    MuHash3072& Remove(const unsigned char* data, size_t len);
+
+    /* Multiply (resulting in a hash for the union of the sets) */
+    MuHash3072& operator*=(const MuHash3072& mul);
+
+    /* Divide (resulting in a hash for the difference of the sets) */
+    MuHash3072& operator/=(const MuHash3072& div);
+
+    /* Finalize into a 32-byte hash. Does not change this object's value. */
+    void Finalize(uint256& out);
+
+    template<typename Stream>
+    void Serialize(Stream& s) const
+    {
+        numerator.Serialize(s);
+        denominator.Serialize(s);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s)
+    {
+        numerator.Unserialize(s);
+        denominator.Unserialize(s);
+    }
+};
+
+#endif // TCOIN_CRYPTO_MUHASH_H
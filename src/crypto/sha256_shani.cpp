@@ -0,0 +1,157 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is only compiled with SHA-NI support enabled (see
+// crypto/libtcoin_crypto_shani.a), and only called after runtime detection.
+// It follows the structure of Intel's "Intel SHA Extensions" reference code.
+
+#ifdef ENABLE_SHANI
+
+#include <stdint.h>
+#include <immintrin.h>
+
+namespace {
+
+alignas(16) const uint32_t KT[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/** Byte swap each 32-bit word. */
+__m128i inline Swap(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL));
+}
+
+__m128i inline Load(const unsigned char* in) { return Swap(_mm_loadu_si128((const __m128i*)in)); }
+void inline Store(unsigned char* out, __m128i x) { _mm_storeu_si128((__m128i*)out, Swap(x)); }
+
+/** Convert the state words a..h from and to the ABEF/CDGH layout the SHA
+ *  instructions operate on. */
+void inline Unshuffle(__m128i& s0, __m128i& s1)
+{
+    __m128i t1 = _mm_shuffle_epi32(s0, 0xB1);
+    __m128i t2 = _mm_shuffle_epi32(s1, 0x1B);
+    s0 = _mm_alignr_epi8(t1, t2, 0x08);
+    s1 = _mm_blend_epi16(t2, t1, 0xF0);
+}
+
+void inline Shuffle(__m128i& s0, __m128i& s1)
+{
+    __m128i t1 = _mm_shuffle_epi32(s0, 0x1B);
+    __m128i t2 = _mm_shuffle_epi32(s1, 0xB1);
+    s0 = _mm_blend_epi16(t1, t2, 0xF0);
+    s1 = _mm_alignr_epi8(t2, t1, 0x08);
+}
+
+/** Run one compression on N independent states (in ABEF/CDGH layout) with
+ *  their messages m[lane][0..3], adding the result into the states. Running
+ *  several lanes side by side hides the latency of the round instructions. */
+template<int N>
+void inline Compress(__m128i* s0, __m128i* s1, __m128i (*m)[4])
+{
+    __m128i save0[N], save1[N];
+    for (int l = 0; l < N; l++) {
+        save0[l] = s0[l];
+        save1[l] = s1[l];
+    }
+    for (int r = 0; r < 16; r++) {
+        const int i = r & 3;
+        const __m128i k = _mm_load_si128((const __m128i*)(KT + 4 * r));
+        for (int l = 0; l < N; l++) {
+            if (r >= 4) {
+                __m128i* w = m[l];
+                w[i] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(w[i], w[(i + 1) & 3]), _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4)), w[(i + 3) & 3]);
+            }
+            __m128i kw = _mm_add_epi32(m[l][i], k);
+            s1[l] = _mm_sha256rnds2_epu32(s1[l], s0[l], kw);
+            s0[l] = _mm_sha256rnds2_epu32(s0[l], s1[l], _mm_shuffle_epi32(kw, 0x0E));
+        }
+    }
+    for (int l = 0; l < N; l++) {
+        s0[l] = _mm_add_epi32(s0[l], save0[l]);
+        s1[l] = _mm_add_epi32(s1[l], save1[l]);
+    }
+}
+
+/** Double-SHA256 of N 64-byte inputs. */
+template<int N>
+void inline TransformD64(unsigned char* out, const unsigned char* in)
+{
+    // The initial state, in ABEF/CDGH layout.
+    const __m128i init0 = _mm_set_epi32(0x6a09e667, 0xbb67ae85, 0x510e527f, 0x9b05688c);
+    const __m128i init1 = _mm_set_epi32(0x3c6ef372, 0xa54ff53a, 0x1f83d9ab, 0x5be0cd19);
+
+    __m128i s0[N], s1[N], t0[N], t1[N], m[N][4];
+
+    // First hash: the 64-byte input, then its padding block.
+    for (int l = 0; l < N; l++) {
+        s0[l] = init0;
+        s1[l] = init1;
+        for (int i = 0; i < 4; i++) m[l][i] = Load(in + 64 * l + 16 * i);
+    }
+    Compress<N>(s0, s1, m);
+    for (int l = 0; l < N; l++) {
+        m[l][0] = _mm_set_epi32(0, 0, 0, 0x80000000);
+        m[l][1] = _mm_setzero_si128();
+        m[l][2] = _mm_setzero_si128();
+        m[l][3] = _mm_set_epi32(512, 0, 0, 0);
+    }
+    Compress<N>(s0, s1, m);
+
+    // Second hash: the 32-byte first hash and its padding, in one block.
+    for (int l = 0; l < N; l++) {
+        Shuffle(s0[l], s1[l]);
+        m[l][0] = s0[l];
+        m[l][1] = s1[l];
+        m[l][2] = _mm_set_epi32(0, 0, 0, 0x80000000);
+        m[l][3] = _mm_set_epi32(256, 0, 0, 0);
+        t0[l] = init0;
+        t1[l] = init1;
+    }
+    Compress<N>(t0, t1, m);
+
+    for (int l = 0; l < N; l++) {
+        Shuffle(t0[l], t1[l]);
+        Store(out + 32 * l, t0[l]);
+        Store(out + 32 * l + 16, t1[l]);
+    }
+}
+
+} // namespace
+
+namespace sha256_shani {
+void Transform(uint32_t* s, const unsigned char* chunk, size_t blocks)
+{
+    __m128i s0 = _mm_loadu_si128((const __m128i*)s);
+    __m128i s1 = _mm_loadu_si128((const __m128i*)(s + 4));
+    Unshuffle(s0, s1);
+
+    while (blocks--) {
+        __m128i m[1][4];
+        for (int i = 0; i < 4; i++) m[0][i] = Load(chunk + 16 * i);
+        Compress<1>(&s0, &s1, m);
+        chunk += 64;
+    }
+
+    Shuffle(s0, s1);
+    _mm_storeu_si128((__m128i*)s, s0);
+    _mm_storeu_si128((__m128i*)(s + 4), s1);
+}
+} // namespace sha256_shani
+
+namespace sha256d64_shani {
+void Transform_2way(unsigned char* out, const unsigned char* in)
+{
+    TransformD64<2>(out, in);
+}
+} // namespace sha256d64_shani
+
+#endif
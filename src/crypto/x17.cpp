@@ -0,0 +1,426 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/x17.h"
+
+#include "crypto/common.h"
+#include "crypto/sph_blake.h"
+#include "crypto/sph_bmw.h"
+#include "crypto/sph_groestl.h"
+#include "crypto/sph_jh.h"
+#include "crypto/sph_keccak.h"
+#include "crypto/sph_skein.h"
+#include "crypto/sph_luffa.h"
+#include "crypto/sph_cubehash.h"
+#include "crypto/sph_shavite.h"
+#include "crypto/sph_simd.h"
+#include "crypto/sph_echo.h"
+#include "crypto/sph_hamsi.h"
+#include "crypto/sph_fugue.h"
+#include "crypto/sph_shabal.h"
+#include "crypto/sph_whirlpool.h"
+#include "crypto/sph_sha2.h"
+#include "crypto/sph_haval.h"
+
+#include <algorithm>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#ifdef ENABLE_AVX2
+namespace x17_avx2
+{
+void Blake512_80_4way(unsigned char* out, const unsigned char* in);
+void BMW512_64_4way(unsigned char* out, const unsigned char* in);
+void Skein512_64_4way(unsigned char* out, const unsigned char* in);
+void JH512_64_4way(unsigned char* out, const unsigned char* in);
+void Keccak512_64_4way(unsigned char* out, const unsigned char* in);
+void Luffa512_64_4way(unsigned char* out, const unsigned char* in);
+void CubeHash512_64_4way(unsigned char* out, const unsigned char* in);
+void Hamsi512_64_4way(unsigned char* out, const unsigned char* in);
+void Shabal512_64_4way(unsigned char* out, const unsigned char* in);
+void SHA512_64_4way(unsigned char* out, const unsigned char* in);
+void HAVAL256_5_64_4way(unsigned char* out, const unsigned char* in);
+void Blake512_80_4way_Midstate(unsigned char* out, const uint64_t* midstate, const unsigned char* tails);
+}
+#endif
+
+#ifdef ENABLE_AESNI
+namespace x17_aesni
+{
+void Groestl512_64(unsigned char* out, const unsigned char* in);
+void Echo512_64(unsigned char* out, const unsigned char* in);
+void Shavite512_64(unsigned char* out, const unsigned char* in);
+}
+#endif
+
+// Internal implementation code.
+namespace
+{
+/** Number of headers that go through the stages together. */
+const size_t LANES = 4;
+
+const size_t STAGE_SIZE = X17_STAGE_SIZE;
+
+/** Hash LANES inputs of a fixed size at once, writing LANES 64-byte outputs.
+ *  Every stage except the AES-based ones (Groestl, SHAvite-3, ECHO) and SIMD,
+ *  Fugue and Whirlpool has one (AVX2, 4-way); there is no 8-lane or SSE4.1
+ *  variant, so these stay null without AVX2. */
+typedef void (*TransformLanes)(unsigned char* out, const unsigned char* in);
+
+TransformLanes Blake512_80_Lanes = nullptr;
+TransformLanes BMW512_64_Lanes = nullptr;
+TransformLanes Skein512_64_Lanes = nullptr;
+TransformLanes JH512_64_Lanes = nullptr;
+TransformLanes Keccak512_64_Lanes = nullptr;
+TransformLanes Luffa512_64_Lanes = nullptr;
+TransformLanes CubeHash512_64_Lanes = nullptr;
+TransformLanes Hamsi512_64_Lanes = nullptr;
+TransformLanes Shabal512_64_Lanes = nullptr;
+TransformLanes SHA512_64_Lanes = nullptr;
+TransformLanes HAVAL256_5_64_Lanes = nullptr;
+
+/** Finish BLAKE-512 for LANES headers given a CX17HeaderHasher midstate and
+ *  their 16-byte tails, writing LANES 64-byte outputs. */
+typedef void (*MidstateLanes)(unsigned char* out, const uint64_t* midstate, const unsigned char* tails);
+
+MidstateLanes Blake512_80_Midstate_Lanes = nullptr;
+
+/** Hash a single 64-byte input, writing a 64-byte output. */
+typedef void (*Transform64)(unsigned char* out, const unsigned char* in);
+
+/** A Transform64 that goes through the sph streaming interface. */
+template<typename Ctx, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+void SphTransform64(unsigned char* out, const unsigned char* in)
+{
+    Ctx ctx;
+    Init(&ctx);
+    Update(&ctx, in, STAGE_SIZE);
+    Close(&ctx, out);
+}
+
+Transform64 Groestl512_64 = SphTransform64<sph_groestl512_context, sph_groestl512_init, sph_groestl512, sph_groestl512_close>;
+Transform64 Shavite512_64 = SphTransform64<sph_shavite512_context, sph_shavite512_init, sph_shavite512, sph_shavite512_close>;
+Transform64 Echo512_64 = SphTransform64<sph_echo512_context, sph_echo512_init, sph_echo512, sph_echo512_close>;
+
+/** Run one X17 stage over `lanes` inputs of len bytes each, using the
+ *  multi-lane transform when one is available and all lanes are in use. */
+template<typename Ctx, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+void Stage(unsigned char* out, const unsigned char* in, size_t lanes, size_t len = STAGE_SIZE, TransformLanes multi = nullptr)
+{
+    if (multi && lanes == LANES) {
+        multi(out, in);
+        return;
+    }
+    Ctx ctx;
+    for (size_t i = 0; i < lanes; i++) {
+        Init(&ctx);
+        Update(&ctx, in + i * len, len);
+        Close(&ctx, out + i * STAGE_SIZE);
+    }
+}
+
+/** Scalar BLAKE-512 of an 80-byte header, split around the message words
+ *  that hold its last 16 bytes. */
+namespace blake512
+{
+const uint64_t IV[8] = {
+    0x6A09E667F3BCC908ull, 0xBB67AE8584CAA73Bull, 0x3C6EF372FE94F82Bull, 0xA54FF53A5F1D36F1ull,
+    0x510E527FADE682D1ull, 0x9B05688C2B3E6C1Full, 0x1F83D9ABFB41BD6Bull, 0x5BE0CD19137E2179ull
+};
+
+const uint64_t CB[16] = {
+    0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull,
+    0x452821E638D01377ull, 0xBE5466CF34E90C6Cull, 0xC0AC29B7C97C50DDull, 0x3F84D5B5B5470917ull,
+    0x9216D5D98979FB1Bull, 0xD1310BA698DFB5ACull, 0x2FFD72DBD01ADFB7ull, 0xB8E1AFED6A267E96ull,
+    0xBA7C9045F12C7F99ull, 0x24A19947B3916CF7ull, 0x0801F2E2858EFC16ull, 0x636920D871574E69ull
+};
+
+const unsigned char SIGMA[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+uint64_t inline RotR(uint64_t x, int n) { return (x >> n) | (x << (64 - n)); }
+
+void inline G(const uint64_t* m, const unsigned char* s, int i, uint64_t& a, uint64_t& b, uint64_t& c, uint64_t& d)
+{
+    a = a + b + (m[s[2 * i]] ^ CB[s[2 * i + 1]]);
+    d = RotR(d ^ a, 32);
+    c = c + d;
+    b = RotR(b ^ c, 25);
+    a = a + b + (m[s[2 * i + 1]] ^ CB[s[2 * i]]);
+    d = RotR(d ^ a, 16);
+    c = c + d;
+    b = RotR(b ^ c, 11);
+}
+
+/** Fill in message words 10-15: the padding of an 80-byte message (a 1 bit,
+ *  the final 1 bit of BLAKE-512 and the 640-bit length). */
+void inline Pad80(uint64_t* m)
+{
+    m[10] = 0x8000000000000000ull;
+    m[11] = 0;
+    m[12] = 0;
+    m[13] = 1;
+    m[14] = 0;
+    m[15] = 640;
+}
+
+/** Round 0 only reads message words 8 and 9 (header bytes 64-79) in its
+ *  fifth G function, which shares no state word with the other seven. */
+void Midstate(uint64_t* midstate, const unsigned char* prefix)
+{
+    uint64_t* v = midstate;
+    uint64_t m[16] = {0};
+    for (int i = 0; i < 8; i++) {
+        m[i] = ReadBE64(prefix + 8 * i);
+        midstate[16 + i] = m[i];
+    }
+    Pad80(m);
+
+    for (int i = 0; i < 8; i++) {
+        v[i] = IV[i];
+        v[i + 8] = CB[i];
+    }
+    v[12] ^= 640;
+    v[13] ^= 640;
+
+    const unsigned char* s = SIGMA[0];
+    G(m, s, 0, v[0], v[4], v[8], v[12]);
+    G(m, s, 1, v[1], v[5], v[9], v[13]);
+    G(m, s, 2, v[2], v[6], v[10], v[14]);
+    G(m, s, 3, v[3], v[7], v[11], v[15]);
+    G(m, s, 5, v[1], v[6], v[11], v[12]);
+    G(m, s, 6, v[2], v[7], v[8], v[13]);
+    G(m, s, 7, v[3], v[4], v[9], v[14]);
+}
+
+void FinishMidstate(unsigned char* out, const uint64_t* midstate, const unsigned char* tail)
+{
+    uint64_t v[16], m[16];
+    memcpy(v, midstate, sizeof(v));
+    memcpy(m, midstate + 16, 8 * sizeof(uint64_t));
+    m[8] = ReadBE64(tail);
+    m[9] = ReadBE64(tail + 8);
+    Pad80(m);
+
+    G(m, SIGMA[0], 4, v[0], v[5], v[10], v[15]);
+    for (int r = 1; r < 16; r++) {
+        const unsigned char* s = SIGMA[r % 10];
+        G(m, s, 0, v[0], v[4], v[8], v[12]);
+        G(m, s, 1, v[1], v[5], v[9], v[13]);
+        G(m, s, 2, v[2], v[6], v[10], v[14]);
+        G(m, s, 3, v[3], v[7], v[11], v[15]);
+        G(m, s, 4, v[0], v[5], v[10], v[15]);
+        G(m, s, 5, v[1], v[6], v[11], v[12]);
+        G(m, s, 6, v[2], v[7], v[8], v[13]);
+        G(m, s, 7, v[3], v[4], v[9], v[14]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        WriteBE64(out + 8 * i, IV[i] ^ v[i] ^ v[i + 8]);
+    }
+}
+} // namespace blake512
+
+/** Run one 64-byte X17 stage over `lanes` inputs, one at a time. */
+void Stage64(unsigned char* out, const unsigned char* in, size_t lanes, Transform64 fn)
+{
+    for (size_t i = 0; i < lanes; i++) {
+        fn(out + i * STAGE_SIZE, in + i * STAGE_SIZE);
+    }
+}
+
+/** Run X17 stages 2 to 17 over `lanes` BLAKE-512 outputs in a (using b as
+ *  scratch space), and write the 32-byte results to out. */
+void HashStages(unsigned char* out, unsigned char* a, unsigned char* b, size_t lanes)
+{
+    Stage<sph_bmw512_context, sph_bmw512_init, sph_bmw512, sph_bmw512_close>(b, a, lanes, STAGE_SIZE, BMW512_64_Lanes);
+    Stage64(a, b, lanes, Groestl512_64);
+    Stage<sph_skein512_context, sph_skein512_init, sph_skein512, sph_skein512_close>(b, a, lanes, STAGE_SIZE, Skein512_64_Lanes);
+    Stage<sph_jh512_context, sph_jh512_init, sph_jh512, sph_jh512_close>(a, b, lanes, STAGE_SIZE, JH512_64_Lanes);
+    Stage<sph_keccak512_context, sph_keccak512_init, sph_keccak512, sph_keccak512_close>(b, a, lanes, STAGE_SIZE, Keccak512_64_Lanes);
+    Stage<sph_luffa512_context, sph_luffa512_init, sph_luffa512, sph_luffa512_close>(a, b, lanes, STAGE_SIZE, Luffa512_64_Lanes);
+    Stage<sph_cubehash512_context, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close>(b, a, lanes, STAGE_SIZE, CubeHash512_64_Lanes);
+    Stage64(a, b, lanes, Shavite512_64);
+    Stage<sph_simd512_context, sph_simd512_init, sph_simd512, sph_simd512_close>(b, a, lanes);
+    Stage64(a, b, lanes, Echo512_64);
+    Stage<sph_hamsi512_context, sph_hamsi512_init, sph_hamsi512, sph_hamsi512_close>(b, a, lanes, STAGE_SIZE, Hamsi512_64_Lanes);
+    Stage<sph_fugue512_context, sph_fugue512_init, sph_fugue512, sph_fugue512_close>(a, b, lanes);
+    Stage<sph_shabal512_context, sph_shabal512_init, sph_shabal512, sph_shabal512_close>(b, a, lanes, STAGE_SIZE, Shabal512_64_Lanes);
+    Stage<sph_whirlpool_context, sph_whirlpool_init, sph_whirlpool, sph_whirlpool_close>(a, b, lanes);
+    Stage<sph_sha512_context, sph_sha512_init, sph_sha512, sph_sha512_close>(b, a, lanes, STAGE_SIZE, SHA512_64_Lanes);
+    Stage<sph_haval256_5_context, sph_haval256_5_init, sph_haval256_5, sph_haval256_5_close>(a, b, lanes, STAGE_SIZE, HAVAL256_5_64_Lanes);
+
+    // HAVAL-256 only fills the first half of each 64-byte slot.
+    for (size_t i = 0; i < lanes; i++) {
+        memcpy(out + i * X17_OUTPUT_SIZE, a + i * STAGE_SIZE, X17_OUTPUT_SIZE);
+    }
+}
+
+#if defined(ENABLE_AESNI) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the CPU supports AES-NI and SSSE3. */
+bool AESNIEnabled()
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) return false;
+    return ((ecx >> 25) & 1) && ((ecx >> 9) & 1);
+}
+#endif
+
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Check whether the CPU and the OS support AVX2. */
+bool AVX2Enabled()
+{
+    uint32_t eax, ebx, ecx, edx;
+    if (__get_cpuid_max(0, nullptr) < 7) return false;
+    __cpuid(1, eax, ebx, ecx, edx);
+    // The OS must have enabled XSAVE and the AVX (YMM) register state.
+    if (!((ecx >> 27) & 1) || !((ecx >> 28) & 1)) return false;
+    uint32_t xcr0_lo, xcr0_hi;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 6) != 6) return false;
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    return (ebx >> 5) & 1;
+}
+#endif
+
+} // namespace
+
+std::string X17AutoDetect()
+{
+    std::string ret;
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    if (AVX2Enabled()) {
+        Blake512_80_Lanes = x17_avx2::Blake512_80_4way;
+        Blake512_80_Midstate_Lanes = x17_avx2::Blake512_80_4way_Midstate;
+        BMW512_64_Lanes = x17_avx2::BMW512_64_4way;
+        Skein512_64_Lanes = x17_avx2::Skein512_64_4way;
+        JH512_64_Lanes = x17_avx2::JH512_64_4way;
+        Keccak512_64_Lanes = x17_avx2::Keccak512_64_4way;
+        Luffa512_64_Lanes = x17_avx2::Luffa512_64_4way;
+        CubeHash512_64_Lanes = x17_avx2::CubeHash512_64_4way;
+        Hamsi512_64_Lanes = x17_avx2::Hamsi512_64_4way;
+        Shabal512_64_Lanes = x17_avx2::Shabal512_64_4way;
+        SHA512_64_Lanes = x17_avx2::SHA512_64_4way;
+        HAVAL256_5_64_Lanes = x17_avx2::HAVAL256_5_64_4way;
+        ret = "avx2(4way;blake512,bmw512,skein512,jh512,keccak512,luffa512,cubehash512,hamsi512,shabal512,sha512,haval256_5)";
+    }
+#endif
+#if defined(ENABLE_AESNI) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+    if (AESNIEnabled()) {
+        Groestl512_64 = x17_aesni::Groestl512_64;
+        Shavite512_64 = x17_aesni::Shavite512_64;
+        Echo512_64 = x17_aesni::Echo512_64;
+        if (!ret.empty()) ret += ",";
+        ret += "aesni(groestl512,shavite512,echo512)";
+    }
+#endif
+    return ret.empty() ? "standard" : ret;
+}
+
+void X17Groestl512_64(unsigned char* out, const unsigned char* in)
+{
+    Groestl512_64(out, in);
+}
+
+void X17Shavite512_64(unsigned char* out, const unsigned char* in)
+{
+    Shavite512_64(out, in);
+}
+
+void X17Echo512_64(unsigned char* out, const unsigned char* in)
+{
+    Echo512_64(out, in);
+}
+
+void X17HashStage4(X17LaneStage stage, unsigned char* out, const unsigned char* in)
+{
+    switch (stage) {
+    case X17_BMW512:
+        Stage<sph_bmw512_context, sph_bmw512_init, sph_bmw512, sph_bmw512_close>(out, in, LANES, STAGE_SIZE, BMW512_64_Lanes);
+        break;
+    case X17_SKEIN512:
+        Stage<sph_skein512_context, sph_skein512_init, sph_skein512, sph_skein512_close>(out, in, LANES, STAGE_SIZE, Skein512_64_Lanes);
+        break;
+    case X17_JH512:
+        Stage<sph_jh512_context, sph_jh512_init, sph_jh512, sph_jh512_close>(out, in, LANES, STAGE_SIZE, JH512_64_Lanes);
+        break;
+    case X17_KECCAK512:
+        Stage<sph_keccak512_context, sph_keccak512_init, sph_keccak512, sph_keccak512_close>(out, in, LANES, STAGE_SIZE, Keccak512_64_Lanes);
+        break;
+    case X17_LUFFA512:
+        Stage<sph_luffa512_context, sph_luffa512_init, sph_luffa512, sph_luffa512_close>(out, in, LANES, STAGE_SIZE, Luffa512_64_Lanes);
+        break;
+    case X17_CUBEHASH512:
+        Stage<sph_cubehash512_context, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close>(out, in, LANES, STAGE_SIZE, CubeHash512_64_Lanes);
+        break;
+    case X17_HAMSI512:
+        Stage<sph_hamsi512_context, sph_hamsi512_init, sph_hamsi512, sph_hamsi512_close>(out, in, LANES, STAGE_SIZE, Hamsi512_64_Lanes);
+        break;
+    case X17_SHABAL512:
+        Stage<sph_shabal512_context, sph_shabal512_init, sph_shabal512, sph_shabal512_close>(out, in, LANES, STAGE_SIZE, Shabal512_64_Lanes);
+        break;
+    case X17_SHA512:
+        Stage<sph_sha512_context, sph_sha512_init, sph_sha512, sph_sha512_close>(out, in, LANES, STAGE_SIZE, SHA512_64_Lanes);
+        break;
+    case X17_HAVAL256_5:
+        Stage<sph_haval256_5_context, sph_haval256_5_init, sph_haval256_5, sph_haval256_5_close>(out, in, LANES, STAGE_SIZE, HAVAL256_5_64_Lanes);
+        break;
+    }
+}
+
+void X17HashHeaders(unsigned char* out, const unsigned char* in, size_t n)
+{
+    unsigned char a[LANES * STAGE_SIZE], b[LANES * STAGE_SIZE];
+
+    while (n > 0) {
+        size_t lanes = std::min(n, LANES);
+
+        Stage<sph_blake512_context, sph_blake512_init, sph_blake512, sph_blake512_close>(a, in, lanes, X17_HEADER_SIZE, Blake512_80_Lanes);
+        HashStages(out, a, b, lanes);
+
+        in += lanes * X17_HEADER_SIZE;
+        out += lanes * X17_OUTPUT_SIZE;
+        n -= lanes;
+    }
+}
+
+CX17HeaderHasher::CX17HeaderHasher(const unsigned char* prefix)
+{
+    blake512::Midstate(midstate, prefix);
+}
+
+void CX17HeaderHasher::Hash(unsigned char* out, const unsigned char* tails, size_t n) const
+{
+    unsigned char a[LANES * STAGE_SIZE], b[LANES * STAGE_SIZE];
+
+    while (n > 0) {
+        size_t lanes = std::min(n, LANES);
+
+        if (Blake512_80_Midstate_Lanes && lanes == LANES) {
+            Blake512_80_Midstate_Lanes(a, midstate, tails);
+        } else {
+            for (size_t i = 0; i < lanes; i++) {
+                blake512::FinishMidstate(a + i * STAGE_SIZE, midstate, tails + i * TAIL_SIZE);
+            }
+        }
+        HashStages(out, a, b, lanes);
+
+        tails += lanes * TAIL_SIZE;
+        out += lanes * X17_OUTPUT_SIZE;
+        n -= lanes;
+    }
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TCOIN_CRYPTO_X17_H
+#define TCOIN_CRYPTO_X17_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+
+/** Size of a serialized block header, the input of X17HashHeaders. */
+static const size_t X17_HEADER_SIZE = 80;
+/** Size of an X17 hash. */
+static const size_t X17_OUTPUT_SIZE = 32;
+/** Size of the intermediate hashes passed between stages. */
+static const size_t X17_STAGE_SIZE = 64;
+
+/** Autodetect the best available X17 stage implementations.
+ *  Returns the name of the implementation. Safe to call more than once. */
+std::string X17AutoDetect();
+
+/** Compute the X17 hashes of n block headers.
+ *
+ *  The headers are read back to back from in (n * X17_HEADER_SIZE bytes) and
+ *  their hashes are written back to back to out (n * X17_OUTPUT_SIZE bytes).
+ *  Headers are hashed four at a time, stage by stage. With AVX2, every stage
+ *  but Groestl, SHAvite-3, SIMD, ECHO, Fugue and Whirlpool processes the four
+ *  headers together; those, and every stage without AVX2, hash them one by
+ *  one. The result is identical to hashing each header with HashX17.
+ */
+void X17HashHeaders(unsigned char* out, const unsigned char* in, size_t n);
+
+/** Compute the X17 hashes of many block headers that share their first 64
+ *  bytes, as when grinding nonces.
+ *
+ *  BLAKE-512, the first X17 stage, hashes a header in a single 128-byte
+ *  block, so there is no midstate in the usual sense. Its first round does
+ *  however mix the first 64 bytes into the state in seven of its eight G
+ *  functions before the last 16 bytes (the end of the merkle root, nTime,
+ *  nBits and nNonce) come in. The constructor does that part once, and
+ *  Hash() only does the rest for each header.
+ *
+ *  External miners reach this through tcoinconsensus_x17_hash_headers in
+ *  libtcoinconsensus.
+ */
+class CX17HeaderHasher
+{
+private:
+    //! BLAKE-512 state after the prefix-only part of round 0, then the prefix as message words
+    uint64_t midstate[24];
+
+public:
+    static const size_t PREFIX_SIZE = 64;
+    static const size_t TAIL_SIZE = X17_HEADER_SIZE - PREFIX_SIZE;
+
+    /** Precompute for headers starting with the PREFIX_SIZE bytes at prefix. */
+    explicit CX17HeaderHasher(const unsigned char* prefix);
+
+    /** Hash n headers, given by their last TAIL_SIZE bytes (read back to back
+     *  from tails), writing n X17_OUTPUT_SIZE-byte hashes back to back to out.
+     *  The result is identical to X17HashHeaders on the full headers. */
+    void Hash(unsigned char* out, const unsigned char* tails, size_t n) const;
+};
+
+/** The AES-based X17 stages on a single 64-byte intermediate hash, using the
+ *  implementation selected by X17AutoDetect (AES-NI when available). The
+ *  64-byte output is identical to the corresponding sph_*512 init/update/close
+ *  sequence. */
+void X17Groestl512_64(unsigned char* out, const unsigned char* in);
+void X17Shavite512_64(unsigned char* out, const unsigned char* in);
+void X17Echo512_64(unsigned char* out, const unsigned char* in);
+
+/** The 64-byte X17 stages that have a four-lane implementation. */
+enum X17LaneStage {
+    X17_BMW512,
+    X17_SKEIN512,
+    X17_JH512,
+    X17_KECCAK512,
+    X17_LUFFA512,
+    X17_CUBEHASH512,
+    X17_HAMSI512,
+    X17_SHABAL512,
+    X17_SHA512,
+    X17_HAVAL256_5
+};
+
+/** Run one X17 stage on four 64-byte intermediate hashes read back to back
+ *  from in, writing four X17_STAGE_SIZE-byte outputs back to back to out
+ *  (HAVAL-256/5 fills the first 32 bytes of each), using the implementation
+ *  selected by X17AutoDetect. The output is identical to the corresponding
+ *  sph init/update/close sequence on each input. */
+void X17HashStage4(X17LaneStage stage, unsigned char* out, const unsigned char* in);
+
+#endif // TCOIN_CRYPTO_X17_H
@@ -0,0 +1,338 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is only compiled with AES-NI support enabled (see
+// crypto/libtcoin_crypto_aesni.a), and only called after runtime detection.
+//
+// The three AES-based X17 stages, specialized for the single 64-byte
+// message every stage after the first one hashes. Each function produces
+// the same 64 bytes as sph_*512_init / sph_*512(64 bytes) / sph_*512_close.
+
+#ifdef ENABLE_AESNI
+
+#include <stdint.h>
+#include <string.h>
+#include <immintrin.h>
+
+namespace x17_aesni {
+namespace {
+
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+
+/** Multiply every byte by 2 in GF(2^8) modulo x^8 + x^4 + x^3 + x + 1. */
+__m128i inline Double(__m128i x)
+{
+    __m128i hi = _mm_cmpgt_epi8(_mm_setzero_si128(), x);
+    return Xor(_mm_add_epi8(x, x), _mm_and_si128(hi, _mm_set1_epi8(0x1b)));
+}
+
+/** The AES MixColumns step applied bytewise across four 128-bit words. */
+void inline MixColumn(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    __m128i ab = Xor(a, b), bc = Xor(b, c), cd = Xor(c, d);
+    __m128i abx = Double(ab), bcx = Double(bc), cdx = Double(cd);
+    __m128i na = Xor(Xor(abx, bc), d);
+    __m128i nb = Xor(Xor(bcx, a), cd);
+    __m128i nc = Xor(Xor(cdx, ab), d);
+    __m128i nd = Xor(Xor(Xor(abx, bcx), Xor(cdx, ab)), c);
+    a = na; b = nb; c = nc; d = nd;
+}
+
+/** Groestl-512.
+ *
+ *  The 8x16 byte state is kept as eight row registers (byte j of row i is
+ *  column j), which turns ShiftBytes into a byte rotation per row and
+ *  MixBytes into a few GF(2^8) doublings and XORs across rows. SubBytes is
+ *  AESENCLAST with a zero key, with AES ShiftRows undone beforehand; that
+ *  inverse permutation and the row rotation are folded into one PSHUFB.
+ */
+namespace groestl {
+
+const int ROUNDS = 14;
+const int SHIFT_P[8] = {0, 1, 2, 3, 4, 5, 6, 11};
+const int SHIFT_Q[8] = {1, 3, 5, 11, 0, 2, 4, 6};
+
+/** PSHUFB mask that rotates a row left by s bytes, then applies the inverse
+ *  of AES ShiftRows: byte k is taken from position (13 * k + s) mod 16. */
+__m128i inline ShiftMask(int s)
+{
+    const __m128i base = _mm_setr_epi8(0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3);
+    return _mm_and_si128(_mm_add_epi8(base, _mm_set1_epi8(s)), _mm_set1_epi8(15));
+}
+
+/** Convert between the column-major byte string and row registers. */
+void inline ToRows(__m128i* rows, const unsigned char* in)
+{
+    unsigned char tmp[8][16];
+    for (int j = 0; j < 16; j++) {
+        for (int i = 0; i < 8; i++) {
+            tmp[i][j] = in[8 * j + i];
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        rows[i] = _mm_loadu_si128((const __m128i*)tmp[i]);
+    }
+}
+
+void inline FromRows(unsigned char* out, const __m128i* rows)
+{
+    unsigned char tmp[8][16];
+    for (int i = 0; i < 8; i++) {
+        _mm_storeu_si128((__m128i*)tmp[i], rows[i]);
+    }
+    for (int j = 0; j < 16; j++) {
+        for (int i = 0; i < 8; i++) {
+            out[8 * j + i] = tmp[i][j];
+        }
+    }
+}
+
+void inline MixBytes(__m128i* a)
+{
+    // Multiplication by the circulant matrix (02 02 03 04 05 03 05 07) with
+    // only two doublings per row, following the Groestl reference AES-NI
+    // code (indices are mod 8):
+    //   t_i = a_i + a_{i+1}, x_i = t_i + t_{i+3}, y_i = t_i + t_{i+2} + a_{i+6}
+    //   b_i = 2 * (2 * x_{i+3} + y_{i+7}) + y_{i+4}
+    __m128i t0 = Xor(a[0], a[1]), t1 = Xor(a[1], a[2]), t2 = Xor(a[2], a[3]), t3 = Xor(a[3], a[4]);
+    __m128i t4 = Xor(a[4], a[5]), t5 = Xor(a[5], a[6]), t6 = Xor(a[6], a[7]), t7 = Xor(a[7], a[0]);
+    __m128i y0 = Xor(Xor(t0, t2), a[6]);
+    __m128i y1 = Xor(Xor(t1, t3), a[7]);
+    __m128i y2 = Xor(Xor(t2, t4), a[0]);
+    __m128i y3 = Xor(Xor(t3, t5), a[1]);
+    __m128i y4 = Xor(Xor(t4, t6), a[2]);
+    __m128i y5 = Xor(Xor(t5, t7), a[3]);
+    __m128i y6 = Xor(Xor(t6, t0), a[4]);
+    __m128i y7 = Xor(Xor(t7, t1), a[5]);
+    __m128i w0 = Xor(Double(Xor(t0, t3)), y4);
+    __m128i w1 = Xor(Double(Xor(t1, t4)), y5);
+    __m128i w2 = Xor(Double(Xor(t2, t5)), y6);
+    __m128i w3 = Xor(Double(Xor(t3, t6)), y7);
+    __m128i w4 = Xor(Double(Xor(t4, t7)), y0);
+    __m128i w5 = Xor(Double(Xor(t5, t0)), y1);
+    __m128i w6 = Xor(Double(Xor(t6, t1)), y2);
+    __m128i w7 = Xor(Double(Xor(t7, t2)), y3);
+    a[0] = Xor(Double(w3), y4);
+    a[1] = Xor(Double(w4), y5);
+    a[2] = Xor(Double(w5), y6);
+    a[3] = Xor(Double(w6), y7);
+    a[4] = Xor(Double(w7), y0);
+    a[5] = Xor(Double(w0), y1);
+    a[6] = Xor(Double(w1), y2);
+    a[7] = Xor(Double(w2), y3);
+}
+
+void inline SubShift(__m128i* x, const __m128i* masks)
+{
+    const __m128i zero = _mm_setzero_si128();
+    x[0] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[0], masks[0]), zero);
+    x[1] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[1], masks[1]), zero);
+    x[2] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[2], masks[2]), zero);
+    x[3] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[3], masks[3]), zero);
+    x[4] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[4], masks[4]), zero);
+    x[5] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[5], masks[5]), zero);
+    x[6] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[6], masks[6]), zero);
+    x[7] = _mm_aesenclast_si128(_mm_shuffle_epi8(x[7], masks[7]), zero);
+}
+
+void PermP(__m128i* x, const __m128i* masks)
+{
+    // Round constant for row 0: byte j is (j << 4) ^ round.
+    const __m128i rc = _mm_setr_epi8(0x00, 0x10, 0x20, 0x30, 0x40, 0x50, 0x60, 0x70,
+                                     (char)0x80, (char)0x90, (char)0xa0, (char)0xb0, (char)0xc0, (char)0xd0, (char)0xe0, (char)0xf0);
+    for (int r = 0; r < ROUNDS; r++) {
+        x[0] = Xor(x[0], Xor(rc, _mm_set1_epi8(r)));
+        SubShift(x, masks);
+        MixBytes(x);
+    }
+}
+
+void PermQ(__m128i* x, const __m128i* masks)
+{
+    // Every byte is complemented; row 7 also gets (j << 4) ^ round.
+    const __m128i ones = _mm_set1_epi8(-1);
+    const __m128i rc = _mm_setr_epi8((char)0xff, (char)0xef, (char)0xdf, (char)0xcf, (char)0xbf, (char)0xaf, (char)0x9f, (char)0x8f,
+                                     0x7f, 0x6f, 0x5f, 0x4f, 0x3f, 0x2f, 0x1f, 0x0f);
+    for (int r = 0; r < ROUNDS; r++) {
+        for (int i = 0; i < 7; i++) x[i] = Xor(x[i], ones);
+        x[7] = Xor(x[7], Xor(rc, _mm_set1_epi8(r)));
+        SubShift(x, masks);
+        MixBytes(x);
+    }
+}
+
+} // namespace groestl
+
+/** SHAvite-3-512: a 14-round Feistel network over four 128-bit words whose
+ *  round function is four AES rounds, keyed by a message expansion that is
+ *  itself built from AES rounds. */
+namespace shavite {
+
+const uint32_t IV512[16] = {
+    0x72FCCDD8, 0x79CA4727, 0x128A077B, 0x40D55AEC,
+    0xD1901A06, 0x430AE307, 0xB29F5CD1, 0xDF07FBFC,
+    0x8E45D73D, 0x681AB538, 0xBDE86578, 0xDD577E47,
+    0xE275EADE, 0x502D9FCD, 0xB9357178, 0x022A4B9A
+};
+
+/** Number of 128-bit round key words. */
+const int RK_WORDS = 112;
+
+/** Four AES rounds keyed by rk[0..3], as used by each Feistel half-round. */
+__m128i inline F(__m128i x, const __m128i* rk)
+{
+    const __m128i zero = _mm_setzero_si128();
+    x = _mm_aesenc_si128(Xor(x, rk[0]), rk[1]);
+    x = _mm_aesenc_si128(x, rk[2]);
+    x = _mm_aesenc_si128(x, rk[3]);
+    return _mm_aesenc_si128(x, zero);
+}
+
+} // namespace shavite
+
+} // namespace
+
+void Groestl512_64(unsigned char* out, const unsigned char* in)
+{
+    using namespace groestl;
+
+    __m128i masks_p[8], masks_q[8];
+    for (int i = 0; i < 8; i++) {
+        masks_p[i] = ShiftMask(SHIFT_P[i]);
+        masks_q[i] = ShiftMask(SHIFT_Q[i]);
+    }
+
+    // A 64-byte message fits in one padded 128-byte block, whose last 8
+    // bytes hold the (big-endian) number of blocks.
+    unsigned char block[128];
+    memcpy(block, in, 64);
+    memset(block + 64, 0, 64);
+    block[64] = 0x80;
+    block[127] = 1;
+
+    // The IV is the output size in bits as a big-endian 1024-bit integer.
+    unsigned char iv[128] = {0};
+    iv[126] = 0x02;
+
+    __m128i h[8], m[8], p[8];
+    ToRows(h, iv);
+    ToRows(m, block);
+    for (int i = 0; i < 8; i++) p[i] = Xor(h[i], m[i]);
+    PermP(p, masks_p);
+    PermQ(m, masks_q);
+    for (int i = 0; i < 8; i++) h[i] = Xor(h[i], Xor(p[i], m[i]));
+
+    // Output transformation: truncate P(h) ^ h to its last 64 bytes.
+    for (int i = 0; i < 8; i++) p[i] = h[i];
+    PermP(p, masks_p);
+    for (int i = 0; i < 8; i++) h[i] = Xor(h[i], p[i]);
+    unsigned char tmp[128];
+    FromRows(tmp, h);
+    memcpy(out, tmp + 64, 64);
+}
+
+void Echo512_64(unsigned char* out, const unsigned char* in)
+{
+    // Chaining value: eight words holding the output size in bits. The
+    // message block holds the 64-byte input, the padding bit, the 16-bit
+    // output size at byte 110 and the 128-bit bit count at byte 112.
+    const __m128i iv = _mm_setr_epi32(512, 0, 0, 0);
+    __m128i m[8];
+    for (int i = 0; i < 4; i++) m[i] = _mm_loadu_si128((const __m128i*)(in + 16 * i));
+    m[4] = _mm_setr_epi32(0x80, 0, 0, 0);
+    m[5] = _mm_setzero_si128();
+    m[6] = _mm_setr_epi32(0, 0, 0, 0x02000000);
+    m[7] = _mm_setr_epi32(512, 0, 0, 0);
+
+    __m128i w[16];
+    for (int i = 0; i < 8; i++) {
+        w[i] = iv;
+        w[i + 8] = m[i];
+    }
+
+    // The counter key starts at the number of message bits and is
+    // incremented for every word; it never carries out of the low 32 bits.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_setr_epi32(1, 0, 0, 0);
+    __m128i k = _mm_setr_epi32(512, 0, 0, 0);
+    for (int r = 0; r < 10; r++) {
+        // BIG.SubWords
+        for (int i = 0; i < 16; i++) {
+            w[i] = _mm_aesenc_si128(_mm_aesenc_si128(w[i], k), zero);
+            k = _mm_add_epi32(k, one);
+        }
+        // BIG.ShiftRows: words are column-major, row i rotates left by i.
+        __m128i t = w[1]; w[1] = w[5]; w[5] = w[9]; w[9] = w[13]; w[13] = t;
+        t = w[2]; w[2] = w[10]; w[10] = t;
+        t = w[6]; w[6] = w[14]; w[14] = t;
+        t = w[15]; w[15] = w[11]; w[11] = w[7]; w[7] = w[3]; w[3] = t;
+        // BIG.MixColumns
+        MixColumn(w[0], w[1], w[2], w[3]);
+        MixColumn(w[4], w[5], w[6], w[7]);
+        MixColumn(w[8], w[9], w[10], w[11]);
+        MixColumn(w[12], w[13], w[14], w[15]);
+    }
+
+    // BIG.Final; only the first four words are part of the output.
+    for (int i = 0; i < 4; i++) {
+        _mm_storeu_si128((__m128i*)(out + 16 * i), Xor(Xor(iv, m[i]), Xor(w[i], w[i + 8])));
+    }
+}
+
+void Shavite512_64(unsigned char* out, const unsigned char* in)
+{
+    using namespace shavite;
+
+    // Padded block: the message, the padding bit, the 128-bit bit count at
+    // byte 110 and the 16-bit output size at byte 126.
+    unsigned char block[128];
+    memcpy(block, in, 64);
+    memset(block + 64, 0, 64);
+    block[64] = 0x80;
+    block[111] = 0x02;
+    block[127] = 0x02;
+
+    // Message expansion, in 128-bit words. The bit count (512, 0, 0, 0) is
+    // mixed into four of the words, in a different order each time.
+    const __m128i zero = _mm_setzero_si128();
+    __m128i rk[RK_WORDS];
+    for (int i = 0; i < 8; i++) rk[i] = _mm_loadu_si128((const __m128i*)(block + 16 * i));
+    int k = 8;
+    for (;;) {
+        for (int s = 0; s < 8; s++, k++) {
+            __m128i x = _mm_aesenc_si128(_mm_shuffle_epi32(rk[k - 8], 0x39), zero);
+            rk[k] = Xor(x, rk[k - 1]);
+            if (k == 8) {
+                rk[k] = Xor(rk[k], _mm_setr_epi32(512, 0, 0, -1));
+            } else if (k == 41) {
+                rk[k] = Xor(rk[k], _mm_setr_epi32(0, 0, 0, ~512));
+            } else if (k == 79) {
+                rk[k] = Xor(rk[k], _mm_setr_epi32(0, 0, 512, -1));
+            } else if (k == 110) {
+                rk[k] = Xor(rk[k], _mm_setr_epi32(0, 512, 0, -1));
+            }
+        }
+        if (k == RK_WORDS) break;
+        for (int s = 0; s < 8; s++, k++) {
+            rk[k] = Xor(rk[k - 8], _mm_alignr_epi8(rk[k - 1], rk[k - 2], 4));
+        }
+    }
+
+    __m128i h[4];
+    for (int i = 0; i < 4; i++) h[i] = _mm_loadu_si128((const __m128i*)(IV512 + 4 * i));
+    __m128i a = h[0], b = h[1], c = h[2], d = h[3];
+    for (int r = 0; r < 14; r++) {
+        a = Xor(a, F(b, rk + 8 * r));
+        c = Xor(c, F(d, rk + 8 * r + 4));
+        __m128i t = d; d = c; c = b; b = a; a = t;
+    }
+    _mm_storeu_si128((__m128i*)(out + 0), Xor(h[0], a));
+    _mm_storeu_si128((__m128i*)(out + 16), Xor(h[1], b));
+    _mm_storeu_si128((__m128i*)(out + 32), Xor(h[2], c));
+    _mm_storeu_si128((__m128i*)(out + 48), Xor(h[3], d));
+}
+
+} // namespace x17_aesni
+
+#endif // ENABLE_AESNI
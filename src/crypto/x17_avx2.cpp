@@ -0,0 +1,1523 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+// This file is only compiled with AVX2 support enabled (see
+// crypto/libtcoin_crypto_avx2.a), and only called after runtime detection.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <utility>
+#include <immintrin.h>
+
+#include "crypto/common.h"
+
+namespace x17_avx2 {
+namespace {
+
+__m256i inline K(uint64_t x) { return _mm256_set1_epi64x(x); }
+__m256i inline Add(__m256i x, __m256i y) { return _mm256_add_epi64(x, y); }
+__m256i inline Add(__m256i x, __m256i y, __m256i z) { return Add(Add(x, y), z); }
+__m256i inline Xor(__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }
+__m256i inline Xor(__m256i x, __m256i y, __m256i z) { return Xor(Xor(x, y), z); }
+__m256i inline And(__m256i x, __m256i y) { return _mm256_and_si256(x, y); }
+__m256i inline Or(__m256i x, __m256i y) { return _mm256_or_si256(x, y); }
+__m256i inline AndNot(__m256i x, __m256i y) { return _mm256_andnot_si256(x, y); }
+__m256i inline ShR(__m256i x, int n) { return _mm256_srli_epi64(x, n); }
+__m256i inline RotR(__m256i x, int n) { return Or(_mm256_srli_epi64(x, n), _mm256_slli_epi64(x, 64 - n)); }
+__m256i inline RotL(__m256i x, int n) { return Or(_mm256_slli_epi64(x, n), _mm256_srli_epi64(x, 64 - n)); }
+__m256i inline Sub(__m256i x, __m256i y) { return _mm256_sub_epi64(x, y); }
+__m256i inline ShL(__m256i x, int n) { return _mm256_slli_epi64(x, n); }
+__m256i inline Not(__m256i x) { return Xor(x, _mm256_set1_epi64x(-1)); }
+
+/** Gather one 64-bit word from each of the four inputs. */
+__m256i inline ReadBE(const unsigned char* in, size_t stride)
+{
+    return _mm256_set_epi64x(ReadBE64(in + 3 * stride), ReadBE64(in + 2 * stride), ReadBE64(in + stride), ReadBE64(in));
+}
+
+__m256i inline ReadLE(const unsigned char* in, size_t stride)
+{
+    return _mm256_set_epi64x(ReadLE64(in + 3 * stride), ReadLE64(in + 2 * stride), ReadLE64(in + stride), ReadLE64(in));
+}
+
+void inline WriteBE(unsigned char* out, __m256i x)
+{
+    alignas(32) uint64_t tmp[4];
+    _mm256_store_si256((__m256i*)tmp, x);
+    WriteBE64(out, tmp[0]);
+    WriteBE64(out + 64, tmp[1]);
+    WriteBE64(out + 128, tmp[2]);
+    WriteBE64(out + 192, tmp[3]);
+}
+
+void inline WriteLE(unsigned char* out, __m256i x)
+{
+    alignas(32) uint64_t tmp[4];
+    _mm256_store_si256((__m256i*)tmp, x);
+    WriteLE64(out, tmp[0]);
+    WriteLE64(out + 64, tmp[1]);
+    WriteLE64(out + 128, tmp[2]);
+    WriteLE64(out + 192, tmp[3]);
+}
+
+/* The 32-bit stages (Luffa, CubeHash, Hamsi, Shabal and HAVAL) keep one word
+ * of each of the four inputs in an __m128i, with the same helpers. */
+__m128i inline K32(uint32_t x) { return _mm_set1_epi32(x); }
+__m128i inline Add(__m128i x, __m128i y) { return _mm_add_epi32(x, y); }
+__m128i inline Add(__m128i x, __m128i y, __m128i z) { return Add(Add(x, y), z); }
+__m128i inline Sub(__m128i x, __m128i y) { return _mm_sub_epi32(x, y); }
+__m128i inline Xor(__m128i x, __m128i y) { return _mm_xor_si128(x, y); }
+__m128i inline Xor(__m128i x, __m128i y, __m128i z) { return Xor(Xor(x, y), z); }
+__m128i inline And(__m128i x, __m128i y) { return _mm_and_si128(x, y); }
+__m128i inline Or(__m128i x, __m128i y) { return _mm_or_si128(x, y); }
+__m128i inline AndNot(__m128i x, __m128i y) { return _mm_andnot_si128(x, y); }
+__m128i inline Not(__m128i x) { return Xor(x, _mm_set1_epi32(-1)); }
+__m128i inline ShL(__m128i x, int n) { return _mm_slli_epi32(x, n); }
+__m128i inline ShR(__m128i x, int n) { return _mm_srli_epi32(x, n); }
+__m128i inline RotL(__m128i x, int n) { return Or(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+__m128i inline RotR(__m128i x, int n) { return Or(_mm_srli_epi32(x, n), _mm_slli_epi32(x, 32 - n)); }
+
+/** Gather one 32-bit word from each of the four inputs. */
+__m128i inline Read32BE(const unsigned char* in, size_t stride)
+{
+    return _mm_set_epi32(ReadBE32(in + 3 * stride), ReadBE32(in + 2 * stride), ReadBE32(in + stride), ReadBE32(in));
+}
+
+__m128i inline Read32LE(const unsigned char* in, size_t stride)
+{
+    return _mm_set_epi32(ReadLE32(in + 3 * stride), ReadLE32(in + 2 * stride), ReadLE32(in + stride), ReadLE32(in));
+}
+
+void inline Write32BE(unsigned char* out, __m128i x)
+{
+    alignas(16) uint32_t tmp[4];
+    _mm_store_si128((__m128i*)tmp, x);
+    WriteBE32(out, tmp[0]);
+    WriteBE32(out + 64, tmp[1]);
+    WriteBE32(out + 128, tmp[2]);
+    WriteBE32(out + 192, tmp[3]);
+}
+
+void inline Write32LE(unsigned char* out, __m128i x)
+{
+    alignas(16) uint32_t tmp[4];
+    _mm_store_si128((__m128i*)tmp, x);
+    WriteLE32(out, tmp[0]);
+    WriteLE32(out + 64, tmp[1]);
+    WriteLE32(out + 128, tmp[2]);
+    WriteLE32(out + 192, tmp[3]);
+}
+
+namespace blake512 {
+
+const uint64_t IV[8] = {
+    0x6A09E667F3BCC908ull, 0xBB67AE8584CAA73Bull, 0x3C6EF372FE94F82Bull, 0xA54FF53A5F1D36F1ull,
+    0x510E527FADE682D1ull, 0x9B05688C2B3E6C1Full, 0x1F83D9ABFB41BD6Bull, 0x5BE0CD19137E2179ull
+};
+
+const uint64_t CB[16] = {
+    0x243F6A8885A308D3ull, 0x13198A2E03707344ull, 0xA4093822299F31D0ull, 0x082EFA98EC4E6C89ull,
+    0x452821E638D01377ull, 0xBE5466CF34E90C6Cull, 0xC0AC29B7C97C50DDull, 0x3F84D5B5B5470917ull,
+    0x9216D5D98979FB1Bull, 0xD1310BA698DFB5ACull, 0x2FFD72DBD01ADFB7ull, 0xB8E1AFED6A267E96ull,
+    0xBA7C9045F12C7F99ull, 0x24A19947B3916CF7ull, 0x0801F2E2858EFC16ull, 0x636920D871574E69ull
+};
+
+const unsigned char SIGMA[10][16] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15 },
+    { 14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3 },
+    { 11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4 },
+    {  7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8 },
+    {  9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13 },
+    {  2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9 },
+    { 12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11 },
+    { 13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10 },
+    {  6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5 },
+    { 10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0 }
+};
+
+void inline G(const __m256i* m, const unsigned char* s, int i, __m256i& a, __m256i& b, __m256i& c, __m256i& d)
+{
+    a = Add(a, b, Xor(m[s[2 * i]], K(CB[s[2 * i + 1]])));
+    d = RotR(Xor(d, a), 32);
+    c = Add(c, d);
+    b = RotR(Xor(b, c), 25);
+    a = Add(a, b, Xor(m[s[2 * i + 1]], K(CB[s[2 * i]])));
+    d = RotR(Xor(d, a), 16);
+    c = Add(c, d);
+    b = RotR(Xor(b, c), 11);
+}
+
+} // namespace blake512
+
+namespace bmw512 {
+
+const uint64_t IV[16] = {
+    0x8081828384858687ull, 0x88898A8B8C8D8E8Full, 0x9091929394959697ull, 0x98999A9B9C9D9E9Full,
+    0xA0A1A2A3A4A5A6A7ull, 0xA8A9AAABACADAEAFull, 0xB0B1B2B3B4B5B6B7ull, 0xB8B9BABBBCBDBEBFull,
+    0xC0C1C2C3C4C5C6C7ull, 0xC8C9CACBCCCDCECFull, 0xD0D1D2D3D4D5D6D7ull, 0xD8D9DADBDCDDDEDFull,
+    0xE0E1E2E3E4E5E6E7ull, 0xE8E9EAEBECEDEEEFull, 0xF0F1F2F3F4F5F6F7ull, 0xF8F9FAFBFCFDFEFFull
+};
+
+/** Chaining value of the final compression. */
+const uint64_t FINAL[16] = {
+    0xAAAAAAAAAAAAAAA0ull, 0xAAAAAAAAAAAAAAA1ull, 0xAAAAAAAAAAAAAAA2ull, 0xAAAAAAAAAAAAAAA3ull,
+    0xAAAAAAAAAAAAAAA4ull, 0xAAAAAAAAAAAAAAA5ull, 0xAAAAAAAAAAAAAAA6ull, 0xAAAAAAAAAAAAAAA7ull,
+    0xAAAAAAAAAAAAAAA8ull, 0xAAAAAAAAAAAAAAA9ull, 0xAAAAAAAAAAAAAAAAull, 0xAAAAAAAAAAAAAAABull,
+    0xAAAAAAAAAAAAAAACull, 0xAAAAAAAAAAAAAAADull, 0xAAAAAAAAAAAAAAAEull, 0xAAAAAAAAAAAAAAAFull
+};
+
+__m256i inline S0(__m256i x) { return Xor(Xor(ShR(x, 1), ShL(x, 3)), Xor(RotL(x, 4), RotL(x, 37))); }
+__m256i inline S1(__m256i x) { return Xor(Xor(ShR(x, 1), ShL(x, 2)), Xor(RotL(x, 13), RotL(x, 43))); }
+__m256i inline S2(__m256i x) { return Xor(Xor(ShR(x, 2), ShL(x, 1)), Xor(RotL(x, 19), RotL(x, 53))); }
+__m256i inline S3(__m256i x) { return Xor(Xor(ShR(x, 2), ShL(x, 2)), Xor(RotL(x, 28), RotL(x, 59))); }
+__m256i inline S4(__m256i x) { return Xor(ShR(x, 1), x); }
+__m256i inline S5(__m256i x) { return Xor(ShR(x, 2), x); }
+
+__m256i inline AddElement(const __m256i* m, const __m256i* h, int j)
+{
+    __m256i x = Sub(Add(RotL(m[j], j + 1), RotL(m[(j + 3) % 16], (j + 3) % 16 + 1)), RotL(m[(j + 10) % 16], (j + 10) % 16 + 1));
+    return Xor(Add(x, K((j + 16) * 0x0555555555555555ull)), h[(j + 7) % 16]);
+}
+
+/** One compression of m under the chaining value h into dh, which must not alias either. */
+void Compress(__m256i* dh, const __m256i* m, const __m256i* h)
+{
+    __m256i t[16], q[32];
+    for (int i = 0; i < 16; i++) {
+        t[i] = Xor(m[i], h[i]);
+    }
+    q[0] = Add(S0(Add(Sub(t[5], t[7]), t[10], Add(t[13], t[14]))), h[1]);
+    q[1] = Add(S1(Sub(Add(Sub(t[6], t[8]), t[11], t[14]), t[15])), h[2]);
+    q[2] = Add(S2(Add(Sub(Add(t[0], t[7], t[9]), t[12]), t[15])), h[3]);
+    q[3] = Add(S3(Add(Sub(Add(Sub(t[0], t[1]), t[8]), t[10]), t[13])), h[4]);
+    q[4] = Add(S4(Sub(Sub(Add(t[1], t[2], t[9]), t[11]), t[14])), h[5]);
+    q[5] = Add(S0(Add(Sub(Add(Sub(t[3], t[2]), t[10]), t[12]), t[15])), h[6]);
+    q[6] = Add(S1(Add(Sub(Sub(Sub(t[4], t[0]), t[3]), t[11]), t[13])), h[7]);
+    q[7] = Add(S2(Sub(Sub(Sub(Sub(t[1], t[4]), t[5]), t[12]), t[14])), h[8]);
+    q[8] = Add(S3(Sub(Add(Sub(Sub(t[2], t[5]), t[6]), t[13]), t[15])), h[9]);
+    q[9] = Add(S4(Add(Sub(Add(Sub(t[0], t[3]), t[6]), t[7]), t[14])), h[10]);
+    q[10] = Add(S0(Add(Sub(Sub(Sub(t[8], t[1]), t[4]), t[7]), t[15])), h[11]);
+    q[11] = Add(S1(Add(Sub(Sub(Sub(t[8], t[0]), t[2]), t[5]), t[9])), h[12]);
+    q[12] = Add(S2(Add(Sub(Sub(Add(t[1], t[3]), t[6]), t[9]), t[10])), h[13]);
+    q[13] = Add(S3(Add(Add(t[2], t[4], t[7]), t[10], t[11])), h[14]);
+    q[14] = Add(S4(Sub(Sub(Add(Sub(t[3], t[5]), t[8]), t[11]), t[12])), h[15]);
+    q[15] = Add(S0(Add(Sub(Sub(Sub(t[12], t[4]), t[6]), t[9]), t[13])), h[0]);
+
+    for (int i = 16; i < 18; i++) {
+        __m256i e = AddElement(m, h, i - 16);
+        for (int k = 0; k < 16; k += 4) {
+            e = Add(e, Add(S1(q[i - 16 + k]), S2(q[i - 15 + k])), Add(S3(q[i - 14 + k]), S0(q[i - 13 + k])));
+        }
+        q[i] = e;
+    }
+    static const int ROT[7] = {5, 11, 27, 32, 37, 43, 53};
+    for (int i = 18; i < 32; i++) {
+        __m256i e = Add(AddElement(m, h, i - 16), S4(q[i - 2]), S5(q[i - 1]));
+        for (int k = 0; k < 14; k += 2) {
+            e = Add(e, q[i - 16 + k], RotL(q[i - 15 + k], ROT[k / 2]));
+        }
+        q[i] = e;
+    }
+
+    __m256i xl = Xor(Xor(q[16], q[17], q[18]), Xor(q[19], q[20], q[21]), Xor(q[22], q[23]));
+    __m256i xh = Xor(Xor(xl, q[24], q[25]), Xor(q[26], q[27], q[28]), Xor(q[29], q[30], q[31]));
+    dh[0] = Add(Xor(ShL(xh, 5), ShR(q[16], 5), m[0]), Xor(xl, q[24], q[0]));
+    dh[1] = Add(Xor(ShR(xh, 7), ShL(q[17], 8), m[1]), Xor(xl, q[25], q[1]));
+    dh[2] = Add(Xor(ShR(xh, 5), ShL(q[18], 5), m[2]), Xor(xl, q[26], q[2]));
+    dh[3] = Add(Xor(ShR(xh, 1), ShL(q[19], 5), m[3]), Xor(xl, q[27], q[3]));
+    dh[4] = Add(Xor(ShR(xh, 3), q[20], m[4]), Xor(xl, q[28], q[4]));
+    dh[5] = Add(Xor(ShL(xh, 6), ShR(q[21], 6), m[5]), Xor(xl, q[29], q[5]));
+    dh[6] = Add(Xor(ShR(xh, 4), ShL(q[22], 6), m[6]), Xor(xl, q[30], q[6]));
+    dh[7] = Add(Xor(ShR(xh, 11), ShL(q[23], 2), m[7]), Xor(xl, q[31], q[7]));
+    dh[8] = Add(RotL(dh[4], 9), Xor(xh, q[24], m[8]), Xor(ShL(xl, 8), q[23], q[8]));
+    dh[9] = Add(RotL(dh[5], 10), Xor(xh, q[25], m[9]), Xor(ShR(xl, 6), q[16], q[9]));
+    dh[10] = Add(RotL(dh[6], 11), Xor(xh, q[26], m[10]), Xor(ShL(xl, 6), q[17], q[10]));
+    dh[11] = Add(RotL(dh[7], 12), Xor(xh, q[27], m[11]), Xor(ShL(xl, 4), q[18], q[11]));
+    dh[12] = Add(RotL(dh[0], 13), Xor(xh, q[28], m[12]), Xor(ShR(xl, 3), q[19], q[12]));
+    dh[13] = Add(RotL(dh[1], 14), Xor(xh, q[29], m[13]), Xor(ShR(xl, 4), q[20], q[13]));
+    dh[14] = Add(RotL(dh[2], 15), Xor(xh, q[30], m[14]), Xor(ShR(xl, 7), q[21], q[14]));
+    dh[15] = Add(RotL(dh[3], 16), Xor(xh, q[31], m[15]), Xor(ShR(xl, 2), q[22], q[15]));
+}
+
+} // namespace bmw512
+
+namespace skein512 {
+
+const uint64_t IV[8] = {
+    0x4903ADFF749C51CEull, 0x0D95DE399746DF03ull, 0x8FD1934127C79BCEull, 0x9A255629FF352CB1ull,
+    0x5DB62599DF6CA7B0ull, 0xEABE394CA9D5C3F4ull, 0x991112C71A75B523ull, 0xAE18A40B660FCC33ull
+};
+
+void inline Mix(__m256i& x0, __m256i& x1, int rc)
+{
+    x0 = Add(x0, x1);
+    x1 = Xor(RotL(x1, rc), x0);
+}
+
+/** Key injection s of Threefish-512. */
+void inline Inject(__m256i* p, const __m256i* k, const uint64_t* t, int s)
+{
+    for (int i = 0; i < 8; i++) {
+        p[i] = Add(p[i], k[(s + i) % 9]);
+    }
+    p[5] = Add(p[5], K(t[s % 3]));
+    p[6] = Add(p[6], K(t[(s + 1) % 3]));
+    p[7] = Add(p[7], K(s));
+}
+
+/** One UBI block: h = E(h, tweak; m) ^ m. */
+void UBI(__m256i* h, const __m256i* m, uint64_t t0, uint64_t t1)
+{
+    __m256i k[9], p[8];
+    k[8] = K(0x1BD11BDAA9FC1A22ull);
+    for (int i = 0; i < 8; i++) {
+        k[i] = h[i];
+        k[8] = Xor(k[8], h[i]);
+        p[i] = m[i];
+    }
+    const uint64_t t[3] = {t0, t1, t0 ^ t1};
+
+    for (int s = 0; s < 18; s += 2) {
+        Inject(p, k, t, s);
+        Mix(p[0], p[1], 46); Mix(p[2], p[3], 36); Mix(p[4], p[5], 19); Mix(p[6], p[7], 37);
+        Mix(p[2], p[1], 33); Mix(p[4], p[7], 27); Mix(p[6], p[5], 14); Mix(p[0], p[3], 42);
+        Mix(p[4], p[1], 17); Mix(p[6], p[3], 49); Mix(p[0], p[5], 36); Mix(p[2], p[7], 39);
+        Mix(p[6], p[1], 44); Mix(p[0], p[7], 9); Mix(p[2], p[5], 54); Mix(p[4], p[3], 56);
+        Inject(p, k, t, s + 1);
+        Mix(p[0], p[1], 39); Mix(p[2], p[3], 30); Mix(p[4], p[5], 34); Mix(p[6], p[7], 24);
+        Mix(p[2], p[1], 13); Mix(p[4], p[7], 50); Mix(p[6], p[5], 10); Mix(p[0], p[3], 17);
+        Mix(p[4], p[1], 25); Mix(p[6], p[3], 29); Mix(p[0], p[5], 39); Mix(p[2], p[7], 43);
+        Mix(p[6], p[1], 8); Mix(p[0], p[7], 35); Mix(p[2], p[5], 56); Mix(p[4], p[3], 22);
+    }
+    Inject(p, k, t, 18);
+
+    for (int i = 0; i < 8; i++) {
+        h[i] = Xor(m[i], p[i]);
+    }
+}
+
+} // namespace skein512
+
+namespace jh512 {
+
+/** Words are kept as (high, low) 64-bit halves: x[2 * i] and x[2 * i + 1]. */
+const uint64_t IV[16] = {
+    0x6fd14b963e00aa17ull, 0x636a2e057a15d543ull, 0x8a225e8d0c97ef0bull, 0xe9341259f2b3c361ull,
+    0x891da0c1536f801eull, 0x2aa9056bea2b6d80ull, 0x588eccdb2075baa6ull, 0xa90f3a76baf83bf7ull,
+    0x0169e60541e34a69ull, 0x46b58a8e2e6fe65aull, 0x1047a7d0c1843c24ull, 0x3b6e71b12d5ac199ull,
+    0xcf57f6ec9db1f856ull, 0xa706887c5716b156ull, 0xe3c2fcdfe68517fbull, 0x545a4678cc8cdd4bull
+};
+
+/** Round constants: even high, even low, odd high, odd low for each of the 42 rounds. */
+const uint64_t C[168] = {
+    0x72d5dea2df15f867ull, 0x7b84150ab7231557ull, 0x81abd6904d5a87f6ull, 0x4e9f4fc5c3d12b40ull,
+    0xea983ae05c45fa9cull, 0x03c5d29966b2999aull, 0x660296b4f2bb538aull, 0xb556141a88dba231ull,
+    0x03a35a5c9a190edbull, 0x403fb20a87c14410ull, 0x1c051980849e951dull, 0x6f33ebad5ee7cddcull,
+    0x10ba139202bf6b41ull, 0xdc786515f7bb27d0ull, 0x0a2c813937aa7850ull, 0x3f1abfd2410091d3ull,
+    0x422d5a0df6cc7e90ull, 0xdd629f9c92c097ceull, 0x185ca70bc72b44acull, 0xd1df65d663c6fc23ull,
+    0x976e6c039ee0b81aull, 0x2105457e446ceca8ull, 0xeef103bb5d8e61faull, 0xfd9697b294838197ull,
+    0x4a8e8537db03302full, 0x2a678d2dfb9f6a95ull, 0x8afe7381f8b8696cull, 0x8ac77246c07f4214ull,
+    0xc5f4158fbdc75ec4ull, 0x75446fa78f11bb80ull, 0x52de75b7aee488bcull, 0x82b8001e98a6a3f4ull,
+    0x8ef48f33a9a36315ull, 0xaa5f5624d5b7f989ull, 0xb6f1ed207c5ae0fdull, 0x36cae95a06422c36ull,
+    0xce2935434efe983dull, 0x533af974739a4ba7ull, 0xd0f51f596f4e8186ull, 0x0e9dad81afd85a9full,
+    0xa7050667ee34626aull, 0x8b0b28be6eb91727ull, 0x47740726c680103full, 0xe0a07e6fc67e487bull,
+    0x0d550aa54af8a4c0ull, 0x91e3e79f978ef19eull, 0x8676728150608dd4ull, 0x7e9e5a41f3e5b062ull,
+    0xfc9f1fec4054207aull, 0xe3e41a00cef4c984ull, 0x4fd794f59dfa95d8ull, 0x552e7e1124c354a5ull,
+    0x5bdf7228bdfe6e28ull, 0x78f57fe20fa5c4b2ull, 0x05897cefee49d32eull, 0x447e9385eb28597full,
+    0x705f6937b324314aull, 0x5e8628f11dd6e465ull, 0xc71b770451b920e7ull, 0x74fe43e823d4878aull,
+    0x7d29e8a3927694f2ull, 0xddcb7a099b30d9c1ull, 0x1d1b30fb5bdc1be0ull, 0xda24494ff29c82bfull,
+    0xa4e7ba31b470bfffull, 0x0d324405def8bc48ull, 0x3baefc3253bbd339ull, 0x459fc3c1e0298ba0ull,
+    0xe5c905fdf7ae090full, 0x947034124290f134ull, 0xa271b701e344ed95ull, 0xe93b8e364f2f984aull,
+    0x88401d63a06cf615ull, 0x47c1444b8752afffull, 0x7ebb4af1e20ac630ull, 0x4670b6c5cc6e8ce6ull,
+    0xa4d5a456bd4fca00ull, 0xda9d844bc83e18aeull, 0x7357ce453064d1adull, 0xe8a6ce68145c2567ull,
+    0xa3da8cf2cb0ee116ull, 0x33e906589a94999aull, 0x1f60b220c26f847bull, 0xd1ceac7fa0d18518ull,
+    0x32595ba18ddd19d3ull, 0x509a1cc0aaa5b446ull, 0x9f3d6367e4046bbaull, 0xf6ca19ab0b56ee7eull,
+    0x1fb179eaa9282174ull, 0xe9bdf7353b3651eeull, 0x1d57ac5a7550d376ull, 0x3a46c2fea37d7001ull,
+    0xf735c1af98a4d842ull, 0x78edec209e6b6779ull, 0x41836315ea3adba8ull, 0xfac33b4d32832c83ull,
+    0xa7403b1f1c2747f3ull, 0x5940f034b72d769aull, 0xe73e4e6cd2214ffdull, 0xb8fd8d39dc5759efull,
+    0x8d9b0c492b49ebdaull, 0x5ba2d74968f3700dull, 0x7d3baed07a8d5584ull, 0xf5a5e9f0e4f88e65ull,
+    0xa0b8a2f436103b53ull, 0x0ca8079e753eec5aull, 0x9168949256e8884full, 0x5bb05c55f8babc4cull,
+    0xe3bb3b99f387947bull, 0x75daf4d6726b1c5dull, 0x64aeac28dc34b36dull, 0x6c34a550b828db71ull,
+    0xf861e2f2108d512aull, 0xe3db643359dd75fcull, 0x1cacbcf143ce3fa2ull, 0x67bbd13c02e843b0ull,
+    0x330a5bca8829a175ull, 0x7f34194db416535cull, 0x923b94c30e794d1eull, 0x797475d7b6eeaf3full,
+    0xeaa8d4f7be1a3921ull, 0x5cf47e094c232751ull, 0x26a32453ba323cd2ull, 0x44a3174a6da6d5adull,
+    0xb51d3ea6aff2c908ull, 0x83593d98916b3c56ull, 0x4cf87ca17286604dull, 0x46e23ecc086ec7f6ull,
+    0x2f9833b3b1bc765eull, 0x2bd666a5efc4e62aull, 0x06f4b6e8bec1d436ull, 0x74ee8215bcef2163ull,
+    0xfdc14e0df453c969ull, 0xa77d5ac406585826ull, 0x7ec1141606e0fa16ull, 0x7e90af3d28639d3full,
+    0xd2c9f2e3009bd20cull, 0x5faace30b7d40c30ull, 0x742a5116f2e03298ull, 0x0deb30d8e3cef89aull,
+    0x4bc59e7bb5f17992ull, 0xff51e66e048668d3ull, 0x9b234d57e6966731ull, 0xcce6a6f3170a7505ull,
+    0xb17681d913326cceull, 0x3c175284f805a262ull, 0xf42bcbb378471547ull, 0xff46548223936a48ull,
+    0x38df58074e5e6565ull, 0xf2fc7c89fc86508eull, 0x31702e44d00bca86ull, 0xf04009a23078474eull,
+    0x65a0ee39d1f73883ull, 0xf75ee937e42c3abdull, 0x2197b2260113f86full, 0xa344edd1ef9fdee7ull,
+    0x8ba0df15762592d9ull, 0x3c85f7f612dc42beull, 0xd8a7ec7cab27b07eull, 0x538d7ddaaa3ea8deull,
+    0xaa25ce93bd0269d8ull, 0x5af643fd1a7308f9ull, 0xc05fefda174a19a5ull, 0x974d66334cfd216aull,
+    0x35b49831db411570ull, 0xea1e0fbbedcd549bull, 0x9ad063a151974072ull, 0xf6759dbf91476fe2ull,
+};
+
+/** Masks of the bit swaps W0..W5 (W6 swaps the two halves). */
+const uint64_t WMASK[6] = {
+    0x5555555555555555ull, 0x3333333333333333ull, 0x0F0F0F0F0F0F0F0Full,
+    0x00FF00FF00FF00FFull, 0x0000FFFF0000FFFFull, 0x00000000FFFFFFFFull
+};
+
+void inline Sbox(__m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3, __m256i c)
+{
+    x3 = Not(x3);
+    x0 = Xor(x0, AndNot(x2, c));
+    __m256i t = Xor(c, And(x0, x1));
+    x0 = Xor(x0, And(x2, x3));
+    x3 = Xor(x3, AndNot(x1, x2));
+    x1 = Xor(x1, And(x0, x2));
+    x2 = Xor(x2, AndNot(x3, x0));
+    x0 = Xor(x0, Or(x1, x3));
+    x3 = Xor(x3, And(x1, x2));
+    x1 = Xor(x1, And(t, x0));
+    x2 = Xor(x2, t);
+}
+
+void inline Lb(__m256i& x0, __m256i& x1, __m256i& x2, __m256i& x3, __m256i& x4, __m256i& x5, __m256i& x6, __m256i& x7)
+{
+    x4 = Xor(x4, x1);
+    x5 = Xor(x5, x2);
+    x6 = Xor(x6, x3, x0);
+    x7 = Xor(x7, x0);
+    x0 = Xor(x0, x5);
+    x1 = Xor(x1, x6);
+    x2 = Xor(x2, x7, x4);
+    x3 = Xor(x3, x4);
+}
+
+__m256i inline Swap(__m256i x, int g)
+{
+    return Or(And(ShR(x, 1 << g), K(WMASK[g])), ShL(And(x, K(WMASK[g])), 1 << g));
+}
+
+void Block(__m256i* x, const __m256i* m)
+{
+    for (int i = 0; i < 8; i++) {
+        x[i] = Xor(x[i], m[i]);
+    }
+    for (int r = 0; r < 42; r++) {
+        for (int lo = 0; lo < 2; lo++) {
+            Sbox(x[0 + lo], x[4 + lo], x[8 + lo], x[12 + lo], K(C[4 * r + lo]));
+            Sbox(x[2 + lo], x[6 + lo], x[10 + lo], x[14 + lo], K(C[4 * r + 2 + lo]));
+            Lb(x[0 + lo], x[4 + lo], x[8 + lo], x[12 + lo], x[2 + lo], x[6 + lo], x[10 + lo], x[14 + lo]);
+        }
+        int g = r % 7;
+        for (int i = 2; i < 16; i += 4) {
+            if (g < 6) {
+                x[i] = Swap(x[i], g);
+                x[i + 1] = Swap(x[i + 1], g);
+            } else {
+                std::swap(x[i], x[i + 1]);
+            }
+        }
+    }
+    for (int i = 0; i < 8; i++) {
+        x[8 + i] = Xor(x[8 + i], m[i]);
+    }
+}
+
+} // namespace jh512
+
+namespace keccak512 {
+
+const uint64_t RC[24] = {
+    0x0000000000000001ull, 0x0000000000008082ull, 0x800000000000808Aull, 0x8000000080008000ull,
+    0x000000000000808Bull, 0x0000000080000001ull, 0x8000000080008081ull, 0x8000000000008009ull,
+    0x000000000000008Aull, 0x0000000000000088ull, 0x0000000080008009ull, 0x000000008000000Aull,
+    0x000000008000808Bull, 0x800000000000008Bull, 0x8000000000008089ull, 0x8000000000008003ull,
+    0x8000000000008002ull, 0x8000000000000080ull, 0x000000000000800Aull, 0x800000008000000Aull,
+    0x8000000080008081ull, 0x8000000000008080ull, 0x0000000080000001ull, 0x8000000080008008ull
+};
+
+} // namespace keccak512
+
+namespace luffa512 {
+
+const uint32_t IV[5][8] = {
+    { 0x6d251e69, 0x44b051e0, 0x4eaa6fb4, 0xdbf78465, 0x6e292011, 0x90152df4, 0xee058139, 0xdef610bb },
+    { 0xc3b44b95, 0xd9d2f256, 0x70eee9a0, 0xde099fa3, 0x5d9b0557, 0x8fc944b3, 0xcf1ccf0e, 0x746cd581 },
+    { 0xf7efc89d, 0x5dba5781, 0x04016ce5, 0xad659c05, 0x0306194f, 0x666d1836, 0x24aa230a, 0x8b264ae7 },
+    { 0x858075d5, 0x36d79cce, 0xe571f7d7, 0x204b1f67, 0x35870c6a, 0x57e9e923, 0x14bcb808, 0x7cde72ce },
+    { 0x6c68e9be, 0x5ec41e22, 0xc825b7c7, 0xaffb4363, 0xf5df3999, 0x0fc688f1, 0xb07224cc, 0x03e86cea }
+};
+
+/** Step constants of each sub-permutation, added to words 0 and 4. */
+const uint32_t RC[5][2][8] = {
+    { { 0x303994a6, 0xc0e65299, 0x6cc33a12, 0xdc56983e, 0x1e00108f, 0x7800423d, 0x8f5b7882, 0x96e1db12 },
+      { 0xe0337818, 0x441ba90d, 0x7f34d442, 0x9389217f, 0xe5a8bce6, 0x5274baf4, 0x26889ba7, 0x9a226e9d } },
+    { { 0xb6de10ed, 0x70f47aae, 0x0707a3d4, 0x1c1e8f51, 0x707a3d45, 0xaeb28562, 0xbaca1589, 0x40a46f3e },
+      { 0x01685f3d, 0x05a17cf4, 0xbd09caca, 0xf4272b28, 0x144ae5cc, 0xfaa7ae2b, 0x2e48f1c1, 0xb923c704 } },
+    { { 0xfc20d9d2, 0x34552e25, 0x7ad8818f, 0x8438764a, 0xbb6de032, 0xedb780c8, 0xd9847356, 0xa2c78434 },
+      { 0xe25e72c1, 0xe623bb72, 0x5c58a4a4, 0x1e38e2e7, 0x78e38b9d, 0x27586719, 0x36eda57f, 0x703aace7 } },
+    { { 0xb213afa5, 0xc84ebe95, 0x4e608a22, 0x56d858fe, 0x343b138f, 0xd0ec4e3d, 0x2ceb4882, 0xb3ad2208 },
+      { 0xe028c9bf, 0x44756f91, 0x7e8fce32, 0x956548be, 0xfe191be2, 0x3cb226e5, 0x5944a28e, 0xa1c4c355 } },
+    { { 0xf0d2e9e3, 0xac11d7fa, 0x1bcb66f2, 0x6f2d9bc9, 0x78602649, 0x8edae952, 0x3b6ba548, 0xedae9520 },
+      { 0x5090d577, 0x2d1925ab, 0xb46496ac, 0xd1925ab0, 0x29131ab6, 0x0fc053c3, 0x3f014f0c, 0xfc053c31 } }
+};
+
+/** Multiplication by 2 in GF(2^8)[x] / (x^8 + x^4 + x^3 + x + 1), applied word-wise. */
+void inline M2(__m128i* d, const __m128i* s)
+{
+    __m128i t = s[7];
+    d[7] = s[6];
+    d[6] = s[5];
+    d[5] = s[4];
+    d[4] = Xor(s[3], t);
+    d[3] = Xor(s[2], t);
+    d[2] = s[1];
+    d[1] = Xor(s[0], t);
+    d[0] = t;
+}
+
+void inline Xor8(__m128i* d, const __m128i* s)
+{
+    for (int i = 0; i < 8; i++) {
+        d[i] = Xor(d[i], s[i]);
+    }
+}
+
+void inline SubCrumb(__m128i& a0, __m128i& a1, __m128i& a2, __m128i& a3)
+{
+    __m128i t = a0;
+    a0 = Or(a0, a1);
+    a2 = Xor(a2, a3);
+    a1 = Not(a1);
+    a0 = Xor(a0, a3);
+    a3 = And(a3, t);
+    a1 = Xor(a1, a3);
+    a3 = Xor(a3, a2);
+    a2 = And(a2, a0);
+    a0 = Not(a0);
+    a2 = Xor(a2, a1);
+    a1 = Or(a1, a3);
+    t = Xor(t, a1);
+    a3 = Xor(a3, a2);
+    a2 = And(a2, a1);
+    a1 = Xor(a1, a0);
+    a0 = t;
+}
+
+void inline MixWord(__m128i& u, __m128i& v)
+{
+    v = Xor(v, u);
+    u = Xor(RotL(u, 2), v);
+    v = Xor(RotL(v, 14), u);
+    u = Xor(RotL(u, 10), v);
+    v = RotL(v, 1);
+}
+
+/** Message injection of the eight words m, followed by the permutation. */
+void Round(__m128i (*v)[8], const __m128i* m)
+{
+    __m128i a[8], b[8], t[8];
+    for (int i = 0; i < 8; i++) {
+        t[i] = Xor(Xor(v[0][i], v[1][i], v[2][i]), Xor(v[3][i], v[4][i]));
+    }
+    M2(a, t);
+    for (int j = 0; j < 5; j++) {
+        Xor8(v[j], a);
+    }
+
+    M2(b, v[0]);
+    Xor8(b, v[1]);
+    M2(v[1], v[1]);
+    Xor8(v[1], v[2]);
+    M2(v[2], v[2]);
+    Xor8(v[2], v[3]);
+    M2(v[3], v[3]);
+    Xor8(v[3], v[4]);
+    M2(v[4], v[4]);
+    Xor8(v[4], v[0]);
+
+    M2(v[0], b);
+    Xor8(v[0], v[4]);
+    M2(v[4], v[4]);
+    Xor8(v[4], v[3]);
+    M2(v[3], v[3]);
+    Xor8(v[3], v[2]);
+    M2(v[2], v[2]);
+    Xor8(v[2], v[1]);
+    M2(v[1], v[1]);
+    Xor8(v[1], b);
+
+    for (int i = 0; i < 8; i++) {
+        t[i] = m[i];
+    }
+    for (int j = 0; j < 5; j++) {
+        if (j > 0) {
+            M2(t, t);
+        }
+        Xor8(v[j], t);
+    }
+
+    for (int j = 0; j < 5; j++) {
+        __m128i* x = v[j];
+        for (int i = 4; i < 8 && j > 0; i++) {
+            x[i] = RotL(x[i], j);
+        }
+        for (int r = 0; r < 8; r++) {
+            SubCrumb(x[0], x[1], x[2], x[3]);
+            SubCrumb(x[5], x[6], x[7], x[4]);
+            for (int i = 0; i < 4; i++) {
+                MixWord(x[i], x[i + 4]);
+            }
+            x[0] = Xor(x[0], K32(RC[j][0][r]));
+            x[4] = Xor(x[4], K32(RC[j][1][r]));
+        }
+    }
+}
+
+} // namespace luffa512
+
+namespace cubehash512 {
+
+const uint32_t IV[32] = {
+    0x2AEA2A61, 0x50F494D4, 0x2D538B8B, 0x4167D83E, 0x3FEE2313, 0xC701CF8C, 0xCC39968E, 0x50AC5695,
+    0x4D42C787, 0xA647A8B3, 0x97CF0BEF, 0x825B4537, 0xEEF864D2, 0xF22090C4, 0xD0E5CD33, 0xA23911AE,
+    0xFCD398D9, 0x148FE485, 0x1B017BEF, 0xB6444532, 0x6A536159, 0x2FF5781C, 0x91FA7934, 0x0DBADEA9,
+    0xD65C8A2B, 0xA5A70E75, 0xB1C62456, 0xBC796576, 0x1921C8F7, 0xE7989AF1, 0x7795D246, 0xD43E3B44
+};
+
+/* CubeHash only adds, rotates and xors 32-bit words, and its word swaps move
+ * whole groups of four. Each __m256i holds four consecutive state words of two
+ * inputs, one per 128-bit half, so the state of a pair fits in eight registers
+ * and the swaps become register renames and in-lane shuffles. */
+__m256i inline Add32(__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }
+__m256i inline RotL32(__m256i x, int n) { return Or(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n)); }
+
+/** Words 0-3 of the input at a in the low half, of the input at b in the high half. */
+__m256i inline Load2(const unsigned char* a, const unsigned char* b)
+{
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_loadu_si128((const __m128i*)a)), _mm_loadu_si128((const __m128i*)b), 1);
+}
+
+void Rounds(__m256i* x, int n)
+{
+    __m256i x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3], x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7];
+    for (int r = 0; r < n; r++) {
+        x4 = Add32(x4, x0);
+        x5 = Add32(x5, x1);
+        x6 = Add32(x6, x2);
+        x7 = Add32(x7, x3);
+        // Rotate, swap x[i] with x[i ^ 8] and xor in x[16 + i].
+        __m256i y0 = Xor(RotL32(x2, 7), x4);
+        __m256i y1 = Xor(RotL32(x3, 7), x5);
+        __m256i y2 = Xor(RotL32(x0, 7), x6);
+        __m256i y3 = Xor(RotL32(x1, 7), x7);
+        // Swap x[16 + i] with x[16 + (i ^ 2)].
+        x4 = Add32(_mm256_shuffle_epi32(x4, 0x4E), y0);
+        x5 = Add32(_mm256_shuffle_epi32(x5, 0x4E), y1);
+        x6 = Add32(_mm256_shuffle_epi32(x6, 0x4E), y2);
+        x7 = Add32(_mm256_shuffle_epi32(x7, 0x4E), y3);
+        // Rotate, swap x[i] with x[i ^ 4] and xor in x[16 + i].
+        x0 = Xor(RotL32(y1, 11), x4);
+        x1 = Xor(RotL32(y0, 11), x5);
+        x2 = Xor(RotL32(y3, 11), x6);
+        x3 = Xor(RotL32(y2, 11), x7);
+        // Swap x[16 + i] with x[16 + (i ^ 1)].
+        x4 = _mm256_shuffle_epi32(x4, 0xB1);
+        x5 = _mm256_shuffle_epi32(x5, 0xB1);
+        x6 = _mm256_shuffle_epi32(x6, 0xB1);
+        x7 = _mm256_shuffle_epi32(x7, 0xB1);
+    }
+    x[0] = x0;
+    x[1] = x1;
+    x[2] = x2;
+    x[3] = x3;
+    x[4] = x4;
+    x[5] = x5;
+    x[6] = x6;
+    x[7] = x7;
+}
+
+} // namespace cubehash512
+
+namespace hamsi512 {
+
+const uint32_t IV[16] = {
+    0x73746565, 0x6c706172, 0x6b204172, 0x656e6265, 0x72672031, 0x302c2062, 0x75732032, 0x3434362c,
+    0x20422d33, 0x30303120, 0x4c657576, 0x656e2d48, 0x65766572, 0x6c65652c, 0x2042656c, 0x6769756d
+};
+
+const uint32_t ALPHA_N[32] = {
+    0xff00f0f0, 0xccccaaaa, 0xf0f0cccc, 0xff00aaaa, 0xccccaaaa, 0xf0f0ff00, 0xaaaacccc, 0xf0f0ff00,
+    0xf0f0cccc, 0xaaaaff00, 0xccccff00, 0xaaaaf0f0, 0xaaaaf0f0, 0xff00cccc, 0xccccf0f0, 0xff00aaaa,
+    0xccccaaaa, 0xff00f0f0, 0xff00aaaa, 0xf0f0cccc, 0xf0f0ff00, 0xccccaaaa, 0xf0f0ff00, 0xaaaacccc,
+    0xaaaaff00, 0xf0f0cccc, 0xaaaaf0f0, 0xccccff00, 0xff00cccc, 0xaaaaf0f0, 0xff00aaaa, 0xccccf0f0
+};
+
+const uint32_t ALPHA_F[32] = {
+    0xcaf9639c, 0x0ff0f9c0, 0x639c0ff0, 0xcaf9f9c0, 0x0ff0f9c0, 0x639ccaf9, 0xf9c00ff0, 0x639ccaf9,
+    0x639c0ff0, 0xf9c0caf9, 0x0ff0caf9, 0xf9c0639c, 0xf9c0639c, 0xcaf90ff0, 0x0ff0639c, 0xcaf9f9c0,
+    0x0ff0f9c0, 0xcaf9639c, 0xcaf9f9c0, 0x639c0ff0, 0x639ccaf9, 0x0ff0f9c0, 0x639ccaf9, 0xf9c00ff0,
+    0xf9c0caf9, 0x639c0ff0, 0xf9c0639c, 0x0ff0caf9, 0xcaf90ff0, 0xf9c0639c, 0xcaf9f9c0, 0x0ff0639c
+};
+
+/** Message expansion: row 8 * i + j is added for bit j (LSB first) of message byte i. */
+const uint32_t T512[64][16] = {
+    { 0xef0b0270, 0x3afd0000, 0x5dae0000, 0x69490000, 0x9b0f3c06, 0x4405b5f9, 0x66140a51, 0x924f5d0a,
+      0xc96b0030, 0xe7250000, 0x2f840000, 0x264f0000, 0x08695bf9, 0x6dfcf137, 0x509f6984, 0x9e69af68 },
+    { 0xc96b0030, 0xe7250000, 0x2f840000, 0x264f0000, 0x08695bf9, 0x6dfcf137, 0x509f6984, 0x9e69af68,
+      0x26600240, 0xddd80000, 0x722a0000, 0x4f060000, 0x936667ff, 0x29f944ce, 0x368b63d5, 0x0c26f262 },
+    { 0x145a3c00, 0xb9e90000, 0x61270000, 0xf1610000, 0xce613d6c, 0xb0493d78, 0x47a96720, 0xe18e24c5,
+      0x23671400, 0xc8b90000, 0xf4c70000, 0xfb750000, 0x73cd2465, 0xf8a6a549, 0x02c40a3f, 0xdc24e61f },
+    { 0x23671400, 0xc8b90000, 0xf4c70000, 0xfb750000, 0x73cd2465, 0xf8a6a549, 0x02c40a3f, 0xdc24e61f,
+      0x373d2800, 0x71500000, 0x95e00000, 0x0a140000, 0xbdac1909, 0x48ef9831, 0x456d6d1f, 0x3daac2da },
+    { 0x54285c00, 0xeaed0000, 0xc5d60000, 0xa1c50000, 0xb3a26770, 0x94a5c4e1, 0x6bb0419d, 0x551b3782,
+      0x9cbb1800, 0xb0d30000, 0x92510000, 0xed930000, 0x593a4345, 0xe114d5f4, 0x430633da, 0x78cace29 },
+    { 0x9cbb1800, 0xb0d30000, 0x92510000, 0xed930000, 0x593a4345, 0xe114d5f4, 0x430633da, 0x78cace29,
+      0xc8934400, 0x5a3e0000, 0x57870000, 0x4c560000, 0xea982435, 0x75b11115, 0x28b67247, 0x2dd1f9ab },
+    { 0x29449c00, 0x64e70000, 0xf24b0000, 0xc2f30000, 0x0ede4e8f, 0x56c23745, 0xf3e04259, 0x8d0d9ec4,
+      0x466d0c00, 0x08620000, 0xdd5d0000, 0xbadd0000, 0x6a927942, 0x441f2b93, 0x218ace6f, 0xbf2c0be2 },
+    { 0x466d0c00, 0x08620000, 0xdd5d0000, 0xbadd0000, 0x6a927942, 0x441f2b93, 0x218ace6f, 0xbf2c0be2,
+      0x6f299000, 0x6c850000, 0x2f160000, 0x782e0000, 0x644c37cd, 0x12dd1cd6, 0xd26a8c36, 0x32219526 },
+    { 0xf6800005, 0x3443c000, 0x24070000, 0x8f3d0000, 0x21373bfb, 0x0ab8d5ae, 0xcdc58b19, 0xd795ba31,
+      0xa67f0001, 0x71378000, 0x19fc0000, 0x96db0000, 0x3a8b6dfd, 0xebcaaef3, 0x2c6d478f, 0xac8e6c88 },
+    { 0xa67f0001, 0x71378000, 0x19fc0000, 0x96db0000, 0x3a8b6dfd, 0xebcaaef3, 0x2c6d478f, 0xac8e6c88,
+      0x50ff0004, 0x45744000, 0x3dfb0000, 0x19e60000, 0x1bbc5606, 0xe1727b5d, 0xe1a8cc96, 0x7b1bd6b9 },
+    { 0xf7750009, 0xcf3cc000, 0xc3d60000, 0x04920000, 0x029519a9, 0xf8e836ba, 0x7a87f14e, 0x9e16981a,
+      0xd46a0000, 0x8dc8c000, 0xa5af0000, 0x4a290000, 0xfc4e427a, 0xc9b4866c, 0x98369604, 0xf746c320 },
+    { 0xd46a0000, 0x8dc8c000, 0xa5af0000, 0x4a290000, 0xfc4e427a, 0xc9b4866c, 0x98369604, 0xf746c320,
+      0x231f0009, 0x42f40000, 0x66790000, 0x4ebb0000, 0xfedb5bd3, 0x315cb0d6, 0xe2b1674a, 0x69505b3a },
+    { 0x774400f0, 0xf15a0000, 0xf5b20000, 0x34140000, 0x89377e8c, 0x5a8bec25, 0x0bc3cd1e, 0xcf3775cb,
+      0xf46c0050, 0x96180000, 0x14a50000, 0x031f0000, 0x42947eb8, 0x66bf7e19, 0x9ca470d2, 0x8a341574 },
+    { 0xf46c0050, 0x96180000, 0x14a50000, 0x031f0000, 0x42947eb8, 0x66bf7e19, 0x9ca470d2, 0x8a341574,
+      0x832800a0, 0x67420000, 0xe1170000, 0x370b0000, 0xcba30034, 0x3c34923c, 0x9767bdcc, 0x450360bf },
+    { 0xe8870170, 0x9d720000, 0x12db0000, 0xd4220000, 0xf2886b27, 0xa921e543, 0x4ef8b518, 0x618813b1,
+      0xb4370060, 0x0c4c0000, 0x56c20000, 0x5cae0000, 0x94541f3f, 0x3b3ef825, 0x1b365f3d, 0xf3d45758 },
+    { 0xb4370060, 0x0c4c0000, 0x56c20000, 0x5cae0000, 0x94541f3f, 0x3b3ef825, 0x1b365f3d, 0xf3d45758,
+      0x5cb00110, 0x913e0000, 0x44190000, 0x888c0000, 0x66dc7418, 0x921f1d66, 0x55ceea25, 0x925c44e9 },
+    { 0x0c720000, 0x49e50f00, 0x42790000, 0x5cea0000, 0x33aa301a, 0x15822514, 0x95a34b7b, 0xb44b0090,
+      0xfe220000, 0xa7580500, 0x25d10000, 0xf7600000, 0x893178da, 0x1fd4f860, 0x4ed0a315, 0xa123ff9f },
+    { 0xfe220000, 0xa7580500, 0x25d10000, 0xf7600000, 0x893178da, 0x1fd4f860, 0x4ed0a315, 0xa123ff9f,
+      0xf2500000, 0xeebd0a00, 0x67a80000, 0xab8a0000, 0xba9b48c0, 0x0a56dd74, 0xdb73e86e, 0x1568ff0f },
+    { 0x45180000, 0xa5b51700, 0xf96a0000, 0x3b480000, 0x1ecc142c, 0x231395d6, 0x16bca6b0, 0xdf33f4df,
+      0xb83d0000, 0x16710600, 0x379a0000, 0xf5b10000, 0x228161ac, 0xae48f145, 0x66241616, 0xc5c1eb3e },
+    { 0xb83d0000, 0x16710600, 0x379a0000, 0xf5b10000, 0x228161ac, 0xae48f145, 0x66241616, 0xc5c1eb3e,
+      0xfd250000, 0xb3c41100, 0xcef00000, 0xcef90000, 0x3c4d7580, 0x8d5b6493, 0x7098b0a6, 0x1af21fe1 },
+    { 0x75a40000, 0xc28b2700, 0x94a40000, 0x90f50000, 0xfb7857e0, 0x49ce0bae, 0x1767c483, 0xaedf667e,
+      0xd1660000, 0x1bbc0300, 0x9eec0000, 0xf6940000, 0x03024527, 0xcf70fcf2, 0xb4431b17, 0x857f3c2b },
+    { 0xd1660000, 0x1bbc0300, 0x9eec0000, 0xf6940000, 0x03024527, 0xcf70fcf2, 0xb4431b17, 0x857f3c2b,
+      0xa4c20000, 0xd9372400, 0x0a480000, 0x66610000, 0xf87a12c7, 0x86bef75c, 0xa324df94, 0x2ba05a55 },
+    { 0x75c90003, 0x0e10c000, 0xd1200000, 0xbaea0000, 0x8bc42f3e, 0x8758b757, 0xbb28761d, 0x00b72e2b,
+      0xeecf0001, 0x6f564000, 0xf33e0000, 0xa79e0000, 0xbdb57219, 0xb711ebc5, 0x4a3b40ba, 0xfeabf254 },
+    { 0xeecf0001, 0x6f564000, 0xf33e0000, 0xa79e0000, 0xbdb57219, 0xb711ebc5, 0x4a3b40ba, 0xfeabf254,
+      0x9b060002, 0x61468000, 0x221e0000, 0x1d740000, 0x36715d27, 0x30495c92, 0xf11336a7, 0xfe1cdc7f },
+    { 0x86790000, 0x3f390002, 0xe19ae000, 0x98560000, 0x9565670e, 0x4e88c8ea, 0xd3dd4944, 0x161ddab9,
+      0x30b70000, 0xe5d00000, 0xf4f46000, 0x42c40000, 0x63b83d6a, 0x78ba9460, 0x21afa1ea, 0xb0a51834 },
+    { 0x30b70000, 0xe5d00000, 0xf4f46000, 0x42c40000, 0x63b83d6a, 0x78ba9460, 0x21afa1ea, 0xb0a51834,
+      0xb6ce0000, 0xdae90002, 0x156e8000, 0xda920000, 0xf6dd5a64, 0x36325c8a, 0xf272e8ae, 0xa6b8c28d },
+    { 0x14190000, 0x23ca003c, 0x50df0000, 0x44b60000, 0x1b6c67b0, 0x3cf3ac75, 0x61e610b0, 0xdbcadb80,
+      0xe3430000, 0x3a4e0014, 0xf2c60000, 0xaa4e0000, 0xdb1e42a6, 0x256bbe15, 0x123db156, 0x3a4e99d7 },
+    { 0xe3430000, 0x3a4e0014, 0xf2c60000, 0xaa4e0000, 0xdb1e42a6, 0x256bbe15, 0x123db156, 0x3a4e99d7,
+      0xf75a0000, 0x19840028, 0xa2190000, 0xeef80000, 0xc0722516, 0x19981260, 0x73dba1e6, 0xe1844257 },
+    { 0x54500000, 0x0671005c, 0x25ae0000, 0x6a1e0000, 0x2ea54edf, 0x664e8512, 0xbfba18c3, 0x7e715d17,
+      0xbc8d0000, 0xfc3b0018, 0x19830000, 0xd10b0000, 0xae1878c4, 0x42a69856, 0x0012da37, 0x2c3b504e },
+    { 0xbc8d0000, 0xfc3b0018, 0x19830000, 0xd10b0000, 0xae1878c4, 0x42a69856, 0x0012da37, 0x2c3b504e,
+      0xe8dd0000, 0xfa4a0044, 0x3c2d0000, 0xbb150000, 0x80bd361b, 0x24e81d44, 0xbfa8c2f4, 0x524a0d59 },
+    { 0x69510000, 0xd4e1009c, 0xc3230000, 0xac2f0000, 0xe4950bae, 0xcea415dc, 0x87ec287c, 0xbce1a3ce,
+      0xc6730000, 0xaf8d000c, 0xa4c10000, 0x218d0000, 0x23111587, 0x7913512f, 0x1d28ac88, 0x378dd173 },
+    { 0xc6730000, 0xaf8d000c, 0xa4c10000, 0x218d0000, 0x23111587, 0x7913512f, 0x1d28ac88, 0x378dd173,
+      0xaf220000, 0x7b6c0090, 0x67e20000, 0x8da20000, 0xc7841e29, 0xb7b744f3, 0x9ac484f4, 0x8b6c72bd },
+    { 0xcc140000, 0xa5630000, 0x5ab90780, 0x3b500000, 0x4bd013ff, 0x879b3418, 0x694348c1, 0xca5a87fe,
+      0x819e0000, 0xec570000, 0x66320280, 0x95f30000, 0x5da92802, 0x48f43cbc, 0xe65aa22d, 0x8e67b7fa },
+    { 0x819e0000, 0xec570000, 0x66320280, 0x95f30000, 0x5da92802, 0x48f43cbc, 0xe65aa22d, 0x8e67b7fa,
+      0x4d8a0000, 0x49340000, 0x3c8b0500, 0xaea30000, 0x16793bfd, 0xcf6f08a4, 0x8f19eaec, 0x443d3004 },
+    { 0x78230000, 0x12fc0000, 0xa93a0b80, 0x90a50000, 0x713e2879, 0x7ee98924, 0xf08ca062, 0x636f8bab,
+      0x02af0000, 0xb7280000, 0xba1c0300, 0x56980000, 0xba8d45d3, 0x8048c667, 0xa95c149a, 0xf4f6ea7b },
+    { 0x02af0000, 0xb7280000, 0xba1c0300, 0x56980000, 0xba8d45d3, 0x8048c667, 0xa95c149a, 0xf4f6ea7b,
+      0x7a8c0000, 0xa5d40000, 0x13260880, 0xc63d0000, 0xcbb36daa, 0xfea14f43, 0x59d0b4f8, 0x979961d0 },
+    { 0xac480000, 0x1ba60000, 0x45fb1380, 0x03430000, 0x5a85316a, 0x1fb250b6, 0xfe72c7fe, 0x91e478f6,
+      0x1e4e0000, 0xdecf0000, 0x6df80180, 0x77240000, 0xec47079e, 0xf4a0694e, 0xcda31812, 0x98aa496e },
+    { 0x1e4e0000, 0xdecf0000, 0x6df80180, 0x77240000, 0xec47079e, 0xf4a0694e, 0xcda31812, 0x98aa496e,
+      0xb2060000, 0xc5690000, 0x28031200, 0x74670000, 0xb6c236f4, 0xeb1239f8, 0x33d1dfec, 0x094e3198 },
+    { 0xaec30000, 0x9c4f0001, 0x79d1e000, 0x2c150000, 0x45cc75b3, 0x6650b736, 0xab92f78f, 0xa312567b,
+      0xdb250000, 0x09290000, 0x49aac000, 0x81e10000, 0xcafe6b59, 0x42793431, 0x43566b76, 0xe86cba2e },
+    { 0xdb250000, 0x09290000, 0x49aac000, 0x81e10000, 0xcafe6b59, 0x42793431, 0x43566b76, 0xe86cba2e,
+      0x75e60000, 0x95660001, 0x307b2000, 0xadf40000, 0x8f321eea, 0x24298307, 0xe8c49cf9, 0x4b7eec55 },
+    { 0x58430000, 0x807e0000, 0x78330001, 0xc66b3800, 0xe7375cdc, 0x79ad3fdd, 0xac73fe6f, 0x3a4479b1,
+      0x1d5a0000, 0x2b720000, 0x488d0000, 0xaf611800, 0x25cb2ec5, 0xc879bfd0, 0x81a20429, 0x1e7536a6 },
+    { 0x1d5a0000, 0x2b720000, 0x488d0000, 0xaf611800, 0x25cb2ec5, 0xc879bfd0, 0x81a20429, 0x1e7536a6,
+      0x45190000, 0xab0c0000, 0x30be0001, 0x690a2000, 0xc2fc7219, 0xb1d4800d, 0x2dd1fa46, 0x24314f17 },
+    { 0xa53b0000, 0x14260000, 0x4e30001e, 0x7cae0000, 0x8f9e0dd5, 0x78dfaa3d, 0xf73168d8, 0x0b1b4946,
+      0x07ed0000, 0xb2500000, 0x8774000a, 0x970d0000, 0x437223ae, 0x48c76ea4, 0xf4786222, 0x9075b1ce },
+    { 0x07ed0000, 0xb2500000, 0x8774000a, 0x970d0000, 0x437223ae, 0x48c76ea4, 0xf4786222, 0x9075b1ce,
+      0xa2d60000, 0xa6760000, 0xc9440014, 0xeba30000, 0xccec2e7b, 0x3018c499, 0x03490afa, 0x9b6ef888 },
+    { 0x88980000, 0x1f940000, 0x7fcf002e, 0xfb4e0000, 0xf158079a, 0x61ae9167, 0xa895706c, 0xe6107494,
+      0x0bc20000, 0xdb630000, 0x7e88000c, 0x15860000, 0x91fd48f3, 0x7581bb43, 0xf460449e, 0xd8b61463 },
+    { 0x0bc20000, 0xdb630000, 0x7e88000c, 0x15860000, 0x91fd48f3, 0x7581bb43, 0xf460449e, 0xd8b61463,
+      0x835a0000, 0xc4f70000, 0x01470022, 0xeec80000, 0x60a54f69, 0x142f2a24, 0x5cf534f2, 0x3ea660f7 },
+    { 0x52500000, 0x29540000, 0x6a61004e, 0xf0ff0000, 0x9a317eec, 0x452341ce, 0xcf568fe5, 0x5303130f,
+      0x538d0000, 0xa9fc0000, 0x9ef70006, 0x56ff0000, 0x0ae4004e, 0x92c5cdf9, 0xa9444018, 0x7f975691 },
+    { 0x538d0000, 0xa9fc0000, 0x9ef70006, 0x56ff0000, 0x0ae4004e, 0x92c5cdf9, 0xa9444018, 0x7f975691,
+      0x01dd0000, 0x80a80000, 0xf4960048, 0xa6000000, 0x90d57ea2, 0xd7e68c37, 0x6612cffd, 0x2c94459e },
+    { 0xe6280000, 0x4c4b0000, 0xa8550000, 0xd3d002e0, 0xd86130b8, 0x98a7b0da, 0x289506b4, 0xd75a4897,
+      0xf0c50000, 0x59230000, 0x45820000, 0xe18d00c0, 0x3b6d0631, 0xc2ed5699, 0xcbe0fe1c, 0x56a7b19f },
+    { 0xf0c50000, 0x59230000, 0x45820000, 0xe18d00c0, 0x3b6d0631, 0xc2ed5699, 0xcbe0fe1c, 0x56a7b19f,
+      0x16ed0000, 0x15680000, 0xedd70000, 0x325d0220, 0xe30c3689, 0x5a4ae643, 0xe375f8a8, 0x81fdf908 },
+    { 0xb4310000, 0x77330000, 0xb15d0000, 0x7fd004e0, 0x78a26138, 0xd116c35d, 0xd256d489, 0x4e6f74de,
+      0xe3060000, 0xbdc10000, 0x87130000, 0xbff20060, 0x2eba0a1a, 0x8db53751, 0x73c5ab06, 0x5bd61539 },
+    { 0xe3060000, 0xbdc10000, 0x87130000, 0xbff20060, 0x2eba0a1a, 0x8db53751, 0x73c5ab06, 0x5bd61539,
+      0x57370000, 0xcaf20000, 0x364e0000, 0xc0220480, 0x56186b22, 0x5ca3f40c, 0xa1937f8f, 0x15b961e7 },
+    { 0x02f20000, 0xa2810000, 0x873f0000, 0xe36c7800, 0x1e1d74ef, 0x073d2bd6, 0xc4c23237, 0x7f32259e,
+      0xbadd0000, 0x13ad0000, 0xb7e70000, 0xf7282800, 0xdf45144d, 0x361ac33a, 0xea5a8d14, 0x2a2c18f0 },
+    { 0xbadd0000, 0x13ad0000, 0xb7e70000, 0xf7282800, 0xdf45144d, 0x361ac33a, 0xea5a8d14, 0x2a2c18f0,
+      0xb82f0000, 0xb12c0000, 0x30d80000, 0x14445000, 0xc15860a2, 0x3127e8ec, 0x2e98bf23, 0x551e3d6e },
+    { 0x1e6c0000, 0xc4420000, 0x8a2e0000, 0xbcb6b800, 0x2c4413b6, 0x8bfdd3da, 0x6a0c1bc8, 0xb99dc2eb,
+      0x92560000, 0x1eda0000, 0xea510000, 0xe8b13000, 0xa93556a5, 0xebfb6199, 0xb15c2254, 0x33c5244f },
+    { 0x92560000, 0x1eda0000, 0xea510000, 0xe8b13000, 0xa93556a5, 0xebfb6199, 0xb15c2254, 0x33c5244f,
+      0x8c3a0000, 0xda980000, 0x607f0000, 0x54078800, 0x85714513, 0x6006b243, 0xdb50399c, 0x8a58e6a4 },
+    { 0x033d0000, 0x08b30000, 0xf33a0000, 0x3ac20007, 0x51298a50, 0x6b6e661f, 0x0ea5cfe3, 0xe6da7ffe,
+      0xa8da0000, 0x96be0000, 0x5c1d0000, 0x07da0002, 0x7d669583, 0x1f98708a, 0xbb668808, 0xda878000 },
+    { 0xa8da0000, 0x96be0000, 0x5c1d0000, 0x07da0002, 0x7d669583, 0x1f98708a, 0xbb668808, 0xda878000,
+      0xabe70000, 0x9e0d0000, 0xaf270000, 0x3d180005, 0x2c4f1fd3, 0x74f61695, 0xb5c347eb, 0x3c5dfffe },
+    { 0x01930000, 0xe7820000, 0xedfb0000, 0xcf0c000b, 0x8dd08d58, 0xbca3b42e, 0x063661e1, 0x536f9e7b,
+      0x92280000, 0xdc850000, 0x57fa0000, 0x56dc0003, 0xbae92316, 0x5aefa30c, 0x90cef752, 0x7b1675d7 },
+    { 0x92280000, 0xdc850000, 0x57fa0000, 0x56dc0003, 0xbae92316, 0x5aefa30c, 0x90cef752, 0x7b1675d7,
+      0x93bb0000, 0x3b070000, 0xba010000, 0x99d00008, 0x3739ae4e, 0xe64c1722, 0x96f896b3, 0x2879ebac },
+    { 0x5fa80000, 0x56030000, 0x43ae0000, 0x64f30013, 0x257e86bf, 0x1311944e, 0x541e95bf, 0x8ea4db69,
+      0x00440000, 0x7f480000, 0xda7c0000, 0x2a230001, 0x3badc9cc, 0xa9b69c87, 0x030a9e60, 0xbe0a679e },
+    { 0x00440000, 0x7f480000, 0xda7c0000, 0x2a230001, 0x3badc9cc, 0xa9b69c87, 0x030a9e60, 0xbe0a679e,
+      0x5fec0000, 0x294b0000, 0x99d20000, 0x4ed00012, 0x1ed34f73, 0xbaa708c9, 0x57140bdf, 0x30aebcf7 },
+    { 0xee930000, 0xd6070000, 0x92c10000, 0x2b9801e0, 0x9451287c, 0x3b6cfb57, 0x45312374, 0x201f6a64,
+      0x7b280000, 0x57420000, 0xa9e50000, 0x634300a0, 0x9edb442f, 0x6d9995bb, 0x27f83b03, 0xc7ff60f0 },
+    { 0x7b280000, 0x57420000, 0xa9e50000, 0x634300a0, 0x9edb442f, 0x6d9995bb, 0x27f83b03, 0xc7ff60f0,
+      0x95bb0000, 0x81450000, 0x3b240000, 0x48db0140, 0x0a8a6c53, 0x56f56eec, 0x62c91877, 0xe7e00a94 }
+};
+
+/** T512 folded into one table per message nibble, built once at startup. */
+struct NibbleTable
+{
+    alignas(32) uint32_t rows[16][16][16];
+
+    NibbleTable()
+    {
+        for (int n = 0; n < 16; n++) {
+            for (int x = 0; x < 16; x++) {
+                for (int w = 0; w < 16; w++) {
+                    uint32_t v = 0;
+                    for (int b = 0; b < 4; b++) {
+                        if ((x >> b) & 1) v ^= T512[4 * n + b][w];
+                    }
+                    rows[n][x][w] = v;
+                }
+            }
+        }
+    }
+};
+
+const NibbleTable expand;
+
+/** Expand one 8-byte block (read little-endian) into the 16 message words. */
+void inline Expand(uint32_t* m, uint64_t block)
+{
+    __m256i lo = _mm256_setzero_si256(), hi = _mm256_setzero_si256();
+    for (int n = 0; n < 16; n++) {
+        const uint32_t* row = expand.rows[n][(block >> (4 * n)) & 15];
+        lo = Xor(lo, _mm256_load_si256((const __m256i*)row));
+        hi = Xor(hi, _mm256_load_si256((const __m256i*)(row + 8)));
+    }
+    _mm256_storeu_si256((__m256i*)m, lo);
+    _mm256_storeu_si256((__m256i*)(m + 8), hi);
+}
+
+void inline Sbox(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    __m128i t = a;
+    a = And(a, c);
+    a = Xor(a, d);
+    c = Xor(c, b, a);
+    d = Or(d, t);
+    d = Xor(d, b);
+    t = Xor(t, c);
+    b = d;
+    d = Or(d, t);
+    d = Xor(d, a);
+    a = And(a, b);
+    t = Xor(t, a);
+    b = Xor(b, d, t);
+    a = c;
+    c = b;
+    b = d;
+    d = Not(t);
+}
+
+void inline L(__m128i& a, __m128i& b, __m128i& c, __m128i& d)
+{
+    a = RotL(a, 13);
+    c = RotL(c, 3);
+    b = Xor(b, a, c);
+    d = Xor(d, c, ShL(a, 3));
+    b = RotL(b, 1);
+    d = RotL(d, 7);
+    a = Xor(a, b, d);
+    c = Xor(c, d, ShL(b, 7));
+    a = RotL(a, 5);
+    c = RotL(c, 22);
+}
+
+void Block(__m128i* h, const __m128i* m, int rounds, const uint32_t* alpha)
+{
+    // Message and chaining words interleave in pairs: m m c c, then c c m m.
+    __m128i s[32];
+    for (int g = 0; g < 8; g++) {
+        const __m128i* first = (g & 2) ? h : m;
+        const __m128i* second = (g & 2) ? m : h;
+        s[4 * g] = first[2 * g];
+        s[4 * g + 1] = first[2 * g + 1];
+        s[4 * g + 2] = second[2 * g];
+        s[4 * g + 3] = second[2 * g + 1];
+    }
+    for (int r = 0; r < rounds; r++) {
+        for (int i = 0; i < 32; i++) {
+            s[i] = Xor(s[i], K32(alpha[i]));
+        }
+        s[1] = Xor(s[1], K32(r));
+        for (int i = 0; i < 8; i++) {
+            Sbox(s[i], s[i + 8], s[i + 16], s[i + 24]);
+        }
+        for (int i = 0; i < 8; i++) {
+            L(s[i], s[8 + (i + 1) % 8], s[16 + (i + 2) % 8], s[24 + (i + 3) % 8]);
+        }
+        L(s[0x00], s[0x02], s[0x05], s[0x07]);
+        L(s[0x10], s[0x13], s[0x15], s[0x16]);
+        L(s[0x09], s[0x0B], s[0x0C], s[0x0E]);
+        L(s[0x19], s[0x1A], s[0x1C], s[0x1F]);
+    }
+    for (int i = 0; i < 8; i++) {
+        h[i] = Xor(h[i], s[i]);
+        h[8 + i] = Xor(h[8 + i], s[16 + i]);
+    }
+}
+
+} // namespace hamsi512
+
+namespace shabal512 {
+
+const uint32_t A_INIT[12] = {
+    0x20728DFD, 0x46C0BD53, 0xE782B699, 0x55304632, 0x71B4EF90, 0x0EA9E82C,
+    0xDBB930F1, 0xFAD06B8B, 0xBE0CAE40, 0x8BD14410, 0x76D2ADAC, 0x28ACAB7F
+};
+
+const uint32_t B_INIT[16] = {
+    0xC1099CB7, 0x07B385F3, 0xE7442C26, 0xCC8AD640, 0xEB6F56C7, 0x1EA81AA9, 0x73B9D314, 0x1DE85D08,
+    0x48910A5A, 0x893B22DB, 0xC5A0DF44, 0xBBC4324E, 0x72D2F240, 0x75941D99, 0x6D8BDE82, 0xA1A7502B
+};
+
+const uint32_t C_INIT[16] = {
+    0xD9BF68D1, 0x58BAD750, 0x56028CB2, 0x8134F359, 0xB5D469D8, 0x941A8CC2, 0x418B2A6E, 0x04052780,
+    0x7F07D787, 0x5194358F, 0x3C60D665, 0xBE97D79A, 0x950C3434, 0xAED9A06D, 0x2537DC8D, 0x7CDB5969
+};
+
+__m128i inline Mul3(__m128i x) { return Add(ShL(x, 1), x); }
+__m128i inline Mul5(__m128i x) { return Add(ShL(x, 2), x); }
+
+void Permute(__m128i* a, __m128i* b, const __m128i* c, const __m128i* m)
+{
+    for (int i = 0; i < 16; i++) {
+        b[i] = RotL(b[i], 17);
+    }
+    for (int j = 0; j < 48; j++) {
+        int i = j % 16;
+        __m128i& x = a[j % 12];
+        __m128i t = Xor(x, Mul5(RotL(a[(j + 11) % 12], 15)), c[(24 - i) % 16]);
+        x = Xor(Xor(Mul3(t), b[(i + 13) % 16]), AndNot(b[(i + 6) % 16], b[(i + 9) % 16]), m[i]);
+        b[i] = Not(Xor(RotL(b[i], 1), x));
+    }
+    for (int j = 0; j < 36; j++) {
+        a[11 - j % 12] = Add(a[11 - j % 12], c[(54 - j) % 16]);
+    }
+}
+
+} // namespace shabal512
+
+namespace sha512 {
+
+const uint64_t IV[8] = {
+    0x6A09E667F3BCC908ull, 0xBB67AE8584CAA73Bull, 0x3C6EF372FE94F82Bull, 0xA54FF53A5F1D36F1ull,
+    0x510E527FADE682D1ull, 0x9B05688C2B3E6C1Full, 0x1F83D9ABFB41BD6Bull, 0x5BE0CD19137E2179ull
+};
+
+const uint64_t K512[80] = {
+    0x428a2f98d728ae22ull, 0x7137449123ef65cdull, 0xb5c0fbcfec4d3b2full, 0xe9b5dba58189dbbcull,
+    0x3956c25bf348b538ull, 0x59f111f1b605d019ull, 0x923f82a4af194f9bull, 0xab1c5ed5da6d8118ull,
+    0xd807aa98a3030242ull, 0x12835b0145706fbeull, 0x243185be4ee4b28cull, 0x550c7dc3d5ffb4e2ull,
+    0x72be5d74f27b896full, 0x80deb1fe3b1696b1ull, 0x9bdc06a725c71235ull, 0xc19bf174cf692694ull,
+    0xe49b69c19ef14ad2ull, 0xefbe4786384f25e3ull, 0x0fc19dc68b8cd5b5ull, 0x240ca1cc77ac9c65ull,
+    0x2de92c6f592b0275ull, 0x4a7484aa6ea6e483ull, 0x5cb0a9dcbd41fbd4ull, 0x76f988da831153b5ull,
+    0x983e5152ee66dfabull, 0xa831c66d2db43210ull, 0xb00327c898fb213full, 0xbf597fc7beef0ee4ull,
+    0xc6e00bf33da88fc2ull, 0xd5a79147930aa725ull, 0x06ca6351e003826full, 0x142929670a0e6e70ull,
+    0x27b70a8546d22ffcull, 0x2e1b21385c26c926ull, 0x4d2c6dfc5ac42aedull, 0x53380d139d95b3dfull,
+    0x650a73548baf63deull, 0x766a0abb3c77b2a8ull, 0x81c2c92e47edaee6ull, 0x92722c851482353bull,
+    0xa2bfe8a14cf10364ull, 0xa81a664bbc423001ull, 0xc24b8b70d0f89791ull, 0xc76c51a30654be30ull,
+    0xd192e819d6ef5218ull, 0xd69906245565a910ull, 0xf40e35855771202aull, 0x106aa07032bbd1b8ull,
+    0x19a4c116b8d2d0c8ull, 0x1e376c085141ab53ull, 0x2748774cdf8eeb99ull, 0x34b0bcb5e19b48a8ull,
+    0x391c0cb3c5c95a63ull, 0x4ed8aa4ae3418acbull, 0x5b9cca4f7763e373ull, 0x682e6ff3d6b2b8a3ull,
+    0x748f82ee5defb2fcull, 0x78a5636f43172f60ull, 0x84c87814a1f0ab72ull, 0x8cc702081a6439ecull,
+    0x90befffa23631e28ull, 0xa4506cebde82bde9ull, 0xbef9a3f7b2c67915ull, 0xc67178f2e372532bull,
+    0xca273eceea26619cull, 0xd186b8c721c0c207ull, 0xeada7dd6cde0eb1eull, 0xf57d4f7fee6ed178ull,
+    0x06f067aa72176fbaull, 0x0a637dc5a2c898a6ull, 0x113f9804bef90daeull, 0x1b710b35131c471bull,
+    0x28db77f523047d84ull, 0x32caab7b40c72493ull, 0x3c9ebe0a15c9bebcull, 0x431d67c49c100d4cull,
+    0x4cc5d4becb3e42b6ull, 0x597f299cfc657e2aull, 0x5fcb6fab3ad6faecull, 0x6c44198c4a475817ull
+};
+
+__m256i inline Ch(__m256i x, __m256i y, __m256i z) { return Xor(z, And(x, Xor(y, z))); }
+__m256i inline Maj(__m256i x, __m256i y, __m256i z) { return Or(And(x, y), And(z, Or(x, y))); }
+__m256i inline Sigma0(__m256i x) { return Xor(RotR(x, 28), RotR(x, 34), RotR(x, 39)); }
+__m256i inline Sigma1(__m256i x) { return Xor(RotR(x, 14), RotR(x, 18), RotR(x, 41)); }
+__m256i inline sigma0(__m256i x) { return Xor(RotR(x, 1), RotR(x, 8), ShR(x, 7)); }
+__m256i inline sigma1(__m256i x) { return Xor(RotR(x, 19), RotR(x, 61), ShR(x, 6)); }
+
+} // namespace sha512
+
+namespace haval256_5 {
+
+const uint32_t IV[8] = {
+    0x243F6A88, 0x85A308D3, 0x13198A2E, 0x03707344, 0xA4093822, 0x299F31D0, 0x082EFA98, 0xEC4E6C89
+};
+
+/** Message word order of each pass. */
+const unsigned char WORD[5][32] = {
+    {  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15,
+      16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30, 31 },
+    {  5, 14, 26, 18, 11, 28,  7, 16,  0, 23, 20, 22,  1, 10,  4,  8,
+      30,  3, 21,  9, 17, 24, 29,  6, 19, 12, 15, 13,  2, 25, 31, 27 },
+    { 19,  9,  4, 20, 28, 17,  8, 22, 29, 14, 25, 12, 24, 30, 16, 26,
+      31, 15,  7,  3,  1,  0, 18, 27, 13,  6, 21, 10, 23, 11,  5,  2 },
+    { 24,  4,  0, 14,  2,  7, 28, 23, 26,  6, 30, 20, 18, 25, 19,  3,
+      22, 11, 31, 21,  8, 27, 12,  9,  1, 29,  5, 15, 17, 10, 16, 13 },
+    { 27,  3, 21, 26, 17, 11, 20, 29, 19,  0, 12,  7, 13,  8, 31, 10,
+       5,  9, 14, 30, 18,  6, 28, 24,  2, 23, 16, 22,  4,  1, 25, 15 }
+};
+
+/** Step constants; the first pass has none. */
+const uint32_t RK[5][32] = {
+    { 0 },
+    { 0x452821E6, 0x38D01377, 0xBE5466CF, 0x34E90C6C, 0xC0AC29B7, 0xC97C50DD, 0x3F84D5B5, 0xB5470917,
+      0x9216D5D9, 0x8979FB1B, 0xD1310BA6, 0x98DFB5AC, 0x2FFD72DB, 0xD01ADFB7, 0xB8E1AFED, 0x6A267E96,
+      0xBA7C9045, 0xF12C7F99, 0x24A19947, 0xB3916CF7, 0x0801F2E2, 0x858EFC16, 0x636920D8, 0x71574E69,
+      0xA458FEA3, 0xF4933D7E, 0x0D95748F, 0x728EB658, 0x718BCD58, 0x82154AEE, 0x7B54A41D, 0xC25A59B5 },
+    { 0x9C30D539, 0x2AF26013, 0xC5D1B023, 0x286085F0, 0xCA417918, 0xB8DB38EF, 0x8E79DCB0, 0x603A180E,
+      0x6C9E0E8B, 0xB01E8A3E, 0xD71577C1, 0xBD314B27, 0x78AF2FDA, 0x55605C60, 0xE65525F3, 0xAA55AB94,
+      0x57489862, 0x63E81440, 0x55CA396A, 0x2AAB10B6, 0xB4CC5C34, 0x1141E8CE, 0xA15486AF, 0x7C72E993,
+      0xB3EE1411, 0x636FBC2A, 0x2BA9C55D, 0x741831F6, 0xCE5C3E16, 0x9B87931E, 0xAFD6BA33, 0x6C24CF5C },
+    { 0x7A325381, 0x28958677, 0x3B8F4898, 0x6B4BB9AF, 0xC4BFE81B, 0x66282193, 0x61D809CC, 0xFB21A991,
+      0x487CAC60, 0x5DEC8032, 0xEF845D5D, 0xE98575B1, 0xDC262302, 0xEB651B88, 0x23893E81, 0xD396ACC5,
+      0x0F6D6FF3, 0x83F44239, 0x2E0B4482, 0xA4842004, 0x69C8F04A, 0x9E1F9B5E, 0x21C66842, 0xF6E96C9A,
+      0x670C9C61, 0xABD388F0, 0x6A51A0D2, 0xD8542F68, 0x960FA728, 0xAB5133A3, 0x6EEF0B6C, 0x137A3BE4 },
+    { 0xBA3BF050, 0x7EFB2A98, 0xA1F1651D, 0x39AF0176, 0x66CA593E, 0x82430E88, 0x8CEE8619, 0x456F9FB4,
+      0x7D84A5C3, 0x3B8B5EBE, 0xE06F75D8, 0x85C12073, 0x401A449F, 0x56C16AA6, 0x4ED3AA62, 0x363F7706,
+      0x1BFEDF72, 0x429B023D, 0x37D0D724, 0xD00A1248, 0xDB0FEAD3, 0x49F1C09B, 0x075372C9, 0x80991B7B,
+      0x25D479D8, 0xF6E8DEF7, 0xE3FE501A, 0xB6794C3B, 0x976CE0BD, 0x04C006BA, 0xC1A94FB6, 0x409F60C4 }
+};
+
+__m128i inline F1(__m128i x6, __m128i x5, __m128i x4, __m128i x3, __m128i x2, __m128i x1, __m128i x0)
+{
+    return Xor(Xor(And(x1, Xor(x0, x4)), And(x2, x5)), Xor(And(x3, x6), x0));
+}
+
+__m128i inline F2(__m128i x6, __m128i x5, __m128i x4, __m128i x3, __m128i x2, __m128i x1, __m128i x0)
+{
+    __m128i t = Xor(Xor(AndNot(x3, x1), And(x4, x5)), Xor(x6, x0));
+    return Xor(And(x2, t), And(x4, Xor(x1, x5)), Xor(And(x3, x5), x0));
+}
+
+__m128i inline F3(__m128i x6, __m128i x5, __m128i x4, __m128i x3, __m128i x2, __m128i x1, __m128i x0)
+{
+    return Xor(Xor(And(x3, Xor(And(x1, x2), x6, x0)), And(x1, x4)), Xor(And(x2, x5), x0));
+}
+
+__m128i inline F4(__m128i x6, __m128i x5, __m128i x4, __m128i x3, __m128i x2, __m128i x1, __m128i x0)
+{
+    __m128i t = And(x3, Xor(And(x1, x2), Or(x4, x6), x5));
+    __m128i u = And(x4, Xor(AndNot(x2, x5), Xor(x1, x6, x0)));
+    return Xor(Xor(t, u), And(x2, x6), x0);
+}
+
+__m128i inline F5(__m128i x6, __m128i x5, __m128i x4, __m128i x3, __m128i x2, __m128i x1, __m128i x0)
+{
+    __m128i t = AndNot(Xor(And(And(x1, x2), x3), x5), x0);
+    return Xor(Xor(t, And(x1, x4)), Xor(And(x2, x5), And(x3, x6)));
+}
+
+/** The pass's boolean function with its argument permutation for five passes. */
+template<int P>
+__m128i inline Phi(__m128i x6, __m128i x5, __m128i x4, __m128i x3, __m128i x2, __m128i x1, __m128i x0)
+{
+    switch (P) {
+    case 1: return F1(x3, x4, x1, x0, x5, x2, x6);
+    case 2: return F2(x6, x2, x1, x0, x3, x4, x5);
+    case 3: return F3(x2, x6, x0, x4, x3, x1, x5);
+    case 4: return F4(x1, x5, x3, x2, x0, x4, x6);
+    default: return F5(x2, x5, x0, x6, x4, x3, x1);
+    }
+}
+
+template<int P>
+void Pass(__m128i* s, const __m128i* w)
+{
+    for (int j = 0; j < 32; j++) {
+        int k = j & 7;
+        __m128i t = Phi<P>(s[(6 - k) & 7], s[(5 - k) & 7], s[(4 - k) & 7], s[(3 - k) & 7], s[(2 - k) & 7], s[(1 - k) & 7], s[(0 - k) & 7]);
+        __m128i& x7 = s[(7 - k) & 7];
+        x7 = Add(Add(RotR(t, 7), RotR(x7, 11)), w[WORD[P - 1][j]], K32(RK[P - 1][j]));
+    }
+}
+
+} // namespace haval256_5
+
+} // namespace
+
+void Blake512_80_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace blake512;
+
+    __m256i m[16];
+    for (int i = 0; i < 10; i++) {
+        m[i] = ReadBE(in + 8 * i, 80);
+    }
+    // Padding of an 80-byte message: a single 1 bit, the final "1" bit of
+    // BLAKE-512 and the 128-bit message length (640 bits).
+    m[10] = K(0x8000000000000000ull);
+    m[11] = K(0);
+    m[12] = K(0);
+    m[13] = K(1);
+    m[14] = K(0);
+    m[15] = K(640);
+
+    __m256i v[16];
+    for (int i = 0; i < 8; i++) {
+        v[i] = K(IV[i]);
+    }
+    v[8] = K(CB[0]);
+    v[9] = K(CB[1]);
+    v[10] = K(CB[2]);
+    v[11] = K(CB[3]);
+    v[12] = K(640 ^ CB[4]);
+    v[13] = K(640 ^ CB[5]);
+    v[14] = K(CB[6]);
+    v[15] = K(CB[7]);
+
+    for (int r = 0; r < 16; r++) {
+        const unsigned char* s = SIGMA[r % 10];
+        G(m, s, 0, v[0], v[4], v[8], v[12]);
+        G(m, s, 1, v[1], v[5], v[9], v[13]);
+        G(m, s, 2, v[2], v[6], v[10], v[14]);
+        G(m, s, 3, v[3], v[7], v[11], v[15]);
+        G(m, s, 4, v[0], v[5], v[10], v[15]);
+        G(m, s, 5, v[1], v[6], v[11], v[12]);
+        G(m, s, 6, v[2], v[7], v[8], v[13]);
+        G(m, s, 7, v[3], v[4], v[9], v[14]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        WriteBE(out + 8 * i, Xor(K(IV[i]), v[i], v[i + 8]));
+    }
+}
+
+void Blake512_80_4way_Midstate(unsigned char* out, const uint64_t* midstate, const unsigned char* tails)
+{
+    using namespace blake512;
+
+    // All lanes share the prefix words m[0..7] and the partial round 0 state.
+    __m256i m[16];
+    for (int i = 0; i < 8; i++) {
+        m[i] = K(midstate[16 + i]);
+    }
+    m[8] = ReadBE(tails, 16);
+    m[9] = ReadBE(tails + 8, 16);
+    m[10] = K(0x8000000000000000ull);
+    m[11] = K(0);
+    m[12] = K(0);
+    m[13] = K(1);
+    m[14] = K(0);
+    m[15] = K(640);
+
+    __m256i v[16];
+    for (int i = 0; i < 16; i++) {
+        v[i] = K(midstate[i]);
+    }
+
+    G(m, SIGMA[0], 4, v[0], v[5], v[10], v[15]);
+    for (int r = 1; r < 16; r++) {
+        const unsigned char* s = SIGMA[r % 10];
+        G(m, s, 0, v[0], v[4], v[8], v[12]);
+        G(m, s, 1, v[1], v[5], v[9], v[13]);
+        G(m, s, 2, v[2], v[6], v[10], v[14]);
+        G(m, s, 3, v[3], v[7], v[11], v[15]);
+        G(m, s, 4, v[0], v[5], v[10], v[15]);
+        G(m, s, 5, v[1], v[6], v[11], v[12]);
+        G(m, s, 6, v[2], v[7], v[8], v[13]);
+        G(m, s, 7, v[3], v[4], v[9], v[14]);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        WriteBE(out + 8 * i, Xor(K(IV[i]), v[i], v[i + 8]));
+    }
+}
+
+void BMW512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace bmw512;
+
+    __m256i m[16], h[16], h2[16];
+    for (int i = 0; i < 8; i++) {
+        m[i] = ReadLE(in + 8 * i, 64);
+    }
+    // Padding of a 64-byte message: one 1 bit and the length (512 bits).
+    m[8] = K(0x80);
+    for (int i = 9; i < 15; i++) {
+        m[i] = K(0);
+    }
+    m[15] = K(512);
+    for (int i = 0; i < 16; i++) {
+        h[i] = K(IV[i]);
+    }
+    Compress(h2, m, h);
+
+    for (int i = 0; i < 16; i++) {
+        h[i] = K(FINAL[i]);
+    }
+    Compress(m, h2, h);
+
+    for (int i = 0; i < 8; i++) {
+        WriteLE(out + 8 * i, m[8 + i]);
+    }
+}
+
+void Skein512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace skein512;
+
+    __m256i h[8], m[8];
+    for (int i = 0; i < 8; i++) {
+        h[i] = K(IV[i]);
+        m[i] = ReadLE(in + 8 * i, 64);
+    }
+    // The message is a single final block; the output block carries the counter 0.
+    UBI(h, m, 64, 480ull << 55);
+    for (int i = 0; i < 8; i++) {
+        m[i] = K(0);
+    }
+    UBI(h, m, 8, 510ull << 55);
+
+    for (int i = 0; i < 8; i++) {
+        WriteLE(out + 8 * i, h[i]);
+    }
+}
+
+void JH512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace jh512;
+
+    __m256i x[16], m[8];
+    for (int i = 0; i < 16; i++) {
+        x[i] = K(IV[i]);
+    }
+    for (int i = 0; i < 8; i++) {
+        m[i] = ReadBE(in + 8 * i, 64);
+    }
+    Block(x, m);
+    // Padding of a 64-byte message: one 1 bit and the length (512 bits).
+    m[0] = K(0x8000000000000000ull);
+    for (int i = 1; i < 7; i++) {
+        m[i] = K(0);
+    }
+    m[7] = K(512);
+    Block(x, m);
+
+    for (int i = 0; i < 8; i++) {
+        WriteBE(out + 8 * i, x[8 + i]);
+    }
+}
+
+void Keccak512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace keccak512;
+
+    __m256i a[25];
+    for (int i = 0; i < 8; i++) {
+        a[i] = ReadLE(in + 8 * i, 64);
+    }
+    // Original Keccak padding (0x01 ... 0x80) in the 72-byte rate.
+    a[8] = K(0x8000000000000001ull);
+    for (int i = 9; i < 25; i++) {
+        a[i] = K(0);
+    }
+
+    for (int round = 0; round < 24; round++) {
+        __m256i c[5], d[5], b[25];
+        for (int x = 0; x < 5; x++) {
+            c[x] = Xor(Xor(a[x], a[x + 5], a[x + 10]), Xor(a[x + 15], a[x + 20]));
+        }
+        for (int x = 0; x < 5; x++) {
+            d[x] = Xor(c[(x + 4) % 5], RotL(c[(x + 1) % 5], 1));
+        }
+        // Theta, rho and pi: lane (x, y) moves to (y, 2x + 3y).
+        b[0] = Xor(a[0], d[0]);
+        b[10] = RotL(Xor(a[1], d[1]), 1);
+        b[20] = RotL(Xor(a[2], d[2]), 62);
+        b[5] = RotL(Xor(a[3], d[3]), 28);
+        b[15] = RotL(Xor(a[4], d[4]), 27);
+        b[16] = RotL(Xor(a[5], d[0]), 36);
+        b[1] = RotL(Xor(a[6], d[1]), 44);
+        b[11] = RotL(Xor(a[7], d[2]), 6);
+        b[21] = RotL(Xor(a[8], d[3]), 55);
+        b[6] = RotL(Xor(a[9], d[4]), 20);
+        b[7] = RotL(Xor(a[10], d[0]), 3);
+        b[17] = RotL(Xor(a[11], d[1]), 10);
+        b[2] = RotL(Xor(a[12], d[2]), 43);
+        b[12] = RotL(Xor(a[13], d[3]), 25);
+        b[22] = RotL(Xor(a[14], d[4]), 39);
+        b[23] = RotL(Xor(a[15], d[0]), 41);
+        b[8] = RotL(Xor(a[16], d[1]), 45);
+        b[18] = RotL(Xor(a[17], d[2]), 15);
+        b[3] = RotL(Xor(a[18], d[3]), 21);
+        b[13] = RotL(Xor(a[19], d[4]), 8);
+        b[14] = RotL(Xor(a[20], d[0]), 18);
+        b[24] = RotL(Xor(a[21], d[1]), 2);
+        b[9] = RotL(Xor(a[22], d[2]), 61);
+        b[19] = RotL(Xor(a[23], d[3]), 56);
+        b[4] = RotL(Xor(a[24], d[4]), 14);
+        for (int y = 0; y < 25; y += 5) {
+            for (int x = 0; x < 5; x++) {
+                a[x + y] = Xor(b[x + y], AndNot(b[(x + 1) % 5 + y], b[(x + 2) % 5 + y]));
+            }
+        }
+        a[0] = Xor(a[0], K(RC[round]));
+    }
+
+    for (int i = 0; i < 8; i++) {
+        WriteLE(out + 8 * i, a[i]);
+    }
+}
+
+void Luffa512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace luffa512;
+
+    __m128i v[5][8], m[8];
+    for (int j = 0; j < 5; j++) {
+        for (int i = 0; i < 8; i++) {
+            v[j][i] = K32(IV[j][i]);
+        }
+    }
+    for (int b = 0; b < 64; b += 32) {
+        for (int i = 0; i < 8; i++) {
+            m[i] = Read32BE(in + b + 4 * i, 64);
+        }
+        Round(v, m);
+    }
+    m[0] = K32(0x80000000);
+    for (int i = 1; i < 8; i++) {
+        m[i] = K32(0);
+    }
+    Round(v, m);
+
+    // Two blank rounds squeeze out 256 bits each.
+    m[0] = K32(0);
+    for (int b = 0; b < 64; b += 32) {
+        Round(v, m);
+        for (int i = 0; i < 8; i++) {
+            Write32BE(out + b + 4 * i, Xor(Xor(v[0][i], v[1][i], v[2][i]), Xor(v[3][i], v[4][i])));
+        }
+    }
+}
+
+void CubeHash512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace cubehash512;
+
+    for (int lane = 0; lane < 4; lane += 2) {
+        const unsigned char* a = in + 64 * lane;
+        unsigned char* o = out + 64 * lane;
+        __m256i x[8];
+        for (int i = 0; i < 8; i++) {
+            x[i] = _mm256_setr_epi32(IV[4 * i], IV[4 * i + 1], IV[4 * i + 2], IV[4 * i + 3], IV[4 * i], IV[4 * i + 1], IV[4 * i + 2], IV[4 * i + 3]);
+        }
+        // The words are little endian, like x86.
+        for (int b = 0; b < 64; b += 32) {
+            x[0] = Xor(x[0], Load2(a + b, a + 64 + b));
+            x[1] = Xor(x[1], Load2(a + b + 16, a + 64 + b + 16));
+            Rounds(x, 16);
+        }
+        x[0] = Xor(x[0], _mm256_setr_epi32(0x80, 0, 0, 0, 0x80, 0, 0, 0));
+        Rounds(x, 16);
+        x[7] = Xor(x[7], _mm256_setr_epi32(0, 0, 0, 1, 0, 0, 0, 1));
+        Rounds(x, 160);
+
+        for (int i = 0; i < 4; i++) {
+            _mm_storeu_si128((__m128i*)(o + 16 * i), _mm256_castsi256_si128(x[i]));
+            _mm_storeu_si128((__m128i*)(o + 64 + 16 * i), _mm256_extracti128_si256(x[i], 1));
+        }
+    }
+}
+
+void Hamsi512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace hamsi512;
+
+    __m128i h[16], m[16];
+    alignas(16) uint32_t lanes[16][4];
+    uint32_t words[16];
+    for (int i = 0; i < 16; i++) {
+        h[i] = K32(IV[i]);
+    }
+    for (int b = 0; b < 64; b += 8) {
+        for (int lane = 0; lane < 4; lane++) {
+            Expand(words, ReadLE64(in + 64 * lane + b));
+            for (int i = 0; i < 16; i++) {
+                lanes[i][lane] = words[i];
+            }
+        }
+        for (int i = 0; i < 16; i++) {
+            m[i] = _mm_load_si128((const __m128i*)lanes[i]);
+        }
+        Block(h, m, 6, ALPHA_N);
+    }
+
+    // The padding and length blocks are the same in every lane.
+    unsigned char pad[8] = {0x80};
+    Expand(words, ReadLE64(pad));
+    for (int i = 0; i < 16; i++) {
+        m[i] = K32(words[i]);
+    }
+    Block(h, m, 6, ALPHA_N);
+    WriteBE64(pad, 512);
+    Expand(words, ReadLE64(pad));
+    for (int i = 0; i < 16; i++) {
+        m[i] = K32(words[i]);
+    }
+    Block(h, m, 12, ALPHA_F);
+
+    for (int i = 0; i < 16; i++) {
+        Write32BE(out + 4 * i, h[i]);
+    }
+}
+
+void Shabal512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace shabal512;
+
+    __m128i a[12], bc[2][16], m[16];
+    __m128i* b = bc[0];
+    __m128i* c = bc[1];
+    for (int i = 0; i < 12; i++) {
+        a[i] = K32(A_INIT[i]);
+    }
+    for (int i = 0; i < 16; i++) {
+        b[i] = K32(B_INIT[i]);
+        c[i] = K32(C_INIT[i]);
+        m[i] = Read32LE(in + 4 * i, 64);
+    }
+    // The message is block W = 1.
+    for (int i = 0; i < 16; i++) {
+        b[i] = Add(b[i], m[i]);
+    }
+    a[0] = Xor(a[0], K32(1));
+    Permute(a, b, c, m);
+    for (int i = 0; i < 16; i++) {
+        c[i] = Sub(c[i], m[i]);
+    }
+    std::swap(b, c);
+
+    // The padding block W = 2 is permuted once more, then three times with B and C swapped.
+    m[0] = K32(0x80);
+    for (int i = 1; i < 16; i++) {
+        m[i] = K32(0);
+    }
+    for (int i = 0; i < 16; i++) {
+        b[i] = Add(b[i], m[i]);
+    }
+    a[0] = Xor(a[0], K32(2));
+    Permute(a, b, c, m);
+    for (int k = 0; k < 3; k++) {
+        std::swap(b, c);
+        a[0] = Xor(a[0], K32(2));
+        Permute(a, b, c, m);
+    }
+
+    for (int i = 0; i < 16; i++) {
+        Write32LE(out + 4 * i, b[i]);
+    }
+}
+
+void SHA512_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace sha512;
+
+    __m256i w[80];
+    for (int i = 0; i < 8; i++) {
+        w[i] = ReadBE(in + 8 * i, 64);
+    }
+    // Padding of a 64-byte message: one 1 bit and the length (512 bits).
+    w[8] = K(0x8000000000000000ull);
+    for (int i = 9; i < 15; i++) {
+        w[i] = K(0);
+    }
+    w[15] = K(512);
+    for (int i = 16; i < 80; i++) {
+        w[i] = Add(Add(sigma1(w[i - 2]), w[i - 7]), Add(sigma0(w[i - 15]), w[i - 16]));
+    }
+
+    __m256i s[8];
+    for (int i = 0; i < 8; i++) {
+        s[i] = K(IV[i]);
+    }
+    for (int i = 0; i < 80; i++) {
+        __m256i t1 = Add(Add(s[7], Sigma1(s[4])), Add(Ch(s[4], s[5], s[6]), K(K512[i]), w[i]));
+        __m256i t2 = Add(Sigma0(s[0]), Maj(s[0], s[1], s[2]));
+        s[7] = s[6];
+        s[6] = s[5];
+        s[5] = s[4];
+        s[4] = Add(s[3], t1);
+        s[3] = s[2];
+        s[2] = s[1];
+        s[1] = s[0];
+        s[0] = Add(t1, t2);
+    }
+
+    for (int i = 0; i < 8; i++) {
+        WriteBE(out + 8 * i, Add(s[i], K(IV[i])));
+    }
+}
+
+void HAVAL256_5_64_4way(unsigned char* out, const unsigned char* in)
+{
+    using namespace haval256_5;
+
+    __m128i w[32], s[8];
+    for (int i = 0; i < 16; i++) {
+        w[i] = Read32LE(in + 4 * i, 64);
+    }
+    // Padding of a 64-byte message in its 128-byte block: one 1 bit, the
+    // version, pass count and output size (0x40290000), then the length.
+    w[16] = K32(0x01);
+    for (int i = 17; i < 29; i++) {
+        w[i] = K32(0);
+    }
+    w[29] = K32(0x40290000);
+    w[30] = K32(512);
+    w[31] = K32(0);
+
+    for (int i = 0; i < 8; i++) {
+        s[i] = K32(IV[i]);
+    }
+    Pass<1>(s, w);
+    Pass<2>(s, w);
+    Pass<3>(s, w);
+    Pass<4>(s, w);
+    Pass<5>(s, w);
+
+    for (int i = 0; i < 8; i++) {
+        Write32LE(out + 4 * i, Add(s[i], K32(IV[i])));
+    }
+}
+
+} // namespace x17_avx2
+
+#endif
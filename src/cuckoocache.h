@@ -415,6 +415,20 @@ public:
         }
     }
 
+    /** for_each_live calls f on every element that has not been marked for
+     * erasure, eg. to persist the cache contents. Not threadsafe with a
+     * concurrent insert.
+     *
+     * @param f a callable taking a const Element&
+     */
+    template <typename F>
+    void for_each_live(F f) const
+    {
+        for (uint32_t i = 0; i < size; ++i)
+            if (!collection_flags.bit_is_set(i))
+                f(table[i]);
+    }
+
     /* contains iterates through the hash locations for a given element
      * and checks to see if it is present.
      *
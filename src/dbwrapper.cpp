@@ -7,6 +7,12 @@
 #include "util.h"
 #include "random.h"
 
+#include <assert.h>
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+
 #include <boost/filesystem.hpp>
 
 #include <leveldb/cache.h>
@@ -15,14 +21,74 @@
 #include <memenv.h>
 #include <stdint.h>
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+bool CDBOptions::Set(const std::string& strName, const std::string& strValue)
+{
+    int32_t n;
+    if (strName == "bloombits") {
+        if (!ParseInt32(strValue, &n) || n < 0 || n > 32)
+            return false;
+        nBloomBits = n;
+    } else if (strName == "blocksize") {
+        // LevelDB clips the block size to this range
+        if (!ParseInt32(strValue, &n) || n < (1 << 10) || n > (4 << 20))
+            return false;
+        nBlockSize = n;
+    } else if (strName == "maxopenfiles") {
+        if (!ParseInt32(strValue, &n) || n < 64 || n > 50000)
+            return false;
+        nMaxOpenFiles = n;
+    } else if (strName == "compression") {
+        if (strValue != "0" && strValue != "1")
+            return false;
+        fCompression = strValue == "1";
+    } else {
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Whether LevelDB compresses table blocks when asked to. Built without Snappy
+ * it silently stores them as they are, so write a compressible table to a
+ * memory environment once and look at its size.
+ */
+static bool LevelDBCompresses()
+{
+    static const bool fCompresses = [] {
+        leveldb::Env* penv = leveldb::NewMemEnv(leveldb::Env::Default());
+        leveldb::Options options;
+        options.env = penv;
+        options.create_if_missing = true;
+        options.compression = leveldb::kSnappyCompression;
+        leveldb::DB* pdb;
+        bool fResult = false;
+        if (leveldb::DB::Open(options, "compression", &pdb).ok()) {
+            const std::string value(1 << 16, 'x');
+            uint64_t nSize = 0;
+            if (pdb->Put(leveldb::WriteOptions(), "k", value).ok()) {
+                pdb->CompactRange(NULL, NULL);
+                leveldb::Range range("a", "z");
+                pdb->GetApproximateSizes(&range, 1, &nSize);
+            }
+            fResult = nSize > 0 && nSize < value.size() / 2;
+            delete pdb;
+        }
+        delete penv;
+        return fResult;
+    }();
+    return fCompresses;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const CDBOptions& dbopts)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
-    options.max_open_files = 64;
+    if (dbopts.nBloomBits > 0)
+        options.filter_policy = leveldb::NewBloomFilterPolicy(dbopts.nBloomBits);
+    options.block_size = dbopts.nBlockSize;
+    options.compression = dbopts.fCompression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
+    options.max_open_files = dbopts.nMaxOpenFiles;
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
         // on corruption in later versions.
@@ -31,14 +97,18 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
+CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const CDBOptions& _dbopts) : dbopts(_dbopts)
 {
     penv = NULL;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    if (dbopts.fCompression && !LevelDBCompresses()) {
+        LogPrintf("LevelDB is built without Snappy, not compressing %s\n", path.string());
+        dbopts.fCompression = false;
+    }
+    options = GetOptions(nCacheSize, dbopts);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -50,14 +120,15 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
             dbwrapper_private::HandleError(result);
         }
         TryCreateDirectory(path);
-        LogPrintf("Opening LevelDB in %s\n", path.string());
+        LogPrintf("Opening LevelDB in %s (bloom filter bits: %d, block size: %u, max open files: %d, compression: %d)\n",
+                  path.string(), dbopts.nBloomBits, dbopts.nBlockSize, dbopts.nMaxOpenFiles, dbopts.fCompression);
     }
     leveldb::Status status = leveldb::DB::Open(options, path.string(), &pdb);
     dbwrapper_private::HandleError(status);
     LogPrintf("Opened LevelDB successfully\n");
 
     // The base-case obfuscation key, which is a noop.
-    obfuscate_key = std::vector<unsigned char>(OBFUSCATE_KEY_NUM_BYTES, '\000');
+    obfuscate_key.clear();
 
     bool key_exists = Read(OBFUSCATE_KEY_KEY, obfuscate_key);
 
@@ -73,7 +144,15 @@ CDBWrapper::CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, b
         LogPrintf("Wrote new obfuscate key for %s: %s\n", path.string(), HexStr(obfuscate_key));
     }
 
-    LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
+    // XORing with a null key changes nothing, so leave it empty and skip
+    // the pass over every value read and written.
+    if (std::all_of(obfuscate_key.begin(), obfuscate_key.end(), [](unsigned char c) { return c == 0; }))
+        obfuscate_key.clear();
+
+    if (obfuscate_key.empty())
+        LogPrintf("Not using obfuscation for %s\n", path.string());
+    else
+        LogPrintf("Using obfuscation key for %s: %s\n", path.string(), HexStr(obfuscate_key));
 }
 
 CDBWrapper::~CDBWrapper()
@@ -122,8 +201,82 @@ bool CDBWrapper::IsEmpty()
     return !(it->Valid());
 }
 
+CDBIterator *CDBWrapper::NewIterator(const CDBSnapshot& snapshot) const
+{
+    assert(&snapshot.parent == this);
+    leveldb::ReadOptions options = iteroptions;
+    options.snapshot = snapshot.psnapshot;
+    return new CDBIterator(*this, pdb->NewIterator(options));
+}
+
+/**
+ * Split [strBegin, strEnd) into up to nParts ranges, by interpolating between
+ * the 8 bytes that follow the common prefix of the two keys. Returns the
+ * boundaries, starting with strBegin and ending with strEnd.
+ */
+static std::vector<std::string> SplitKeyRange(const std::string& strBegin, const std::string& strEnd, int nParts)
+{
+    size_t nPrefix = 0;
+    while (nPrefix < strBegin.size() && nPrefix < strEnd.size() && strBegin[nPrefix] == strEnd[nPrefix])
+        nPrefix++;
+    auto ReadBE64 = [nPrefix](const std::string& str) {
+        uint64_t n = 0;
+        for (size_t i = nPrefix; i < nPrefix + 8; i++)
+            n = (n << 8) | (i < str.size() ? (unsigned char)str[i] : 0);
+        return n;
+    };
+    uint64_t nBegin = ReadBE64(strBegin), nEnd = ReadBE64(strEnd);
+
+    std::vector<std::string> vBounds(1, strBegin);
+    for (int i = 1; i < nParts && nEnd > nBegin; i++) {
+        uint64_t n = nBegin + (nEnd - nBegin) / nParts * i;
+        std::string strBound = strBegin.substr(0, nPrefix);
+        for (int j = 7; j >= 0; j--)
+            strBound.push_back((char)(n >> (8 * j)));
+        if (strBound > vBounds.back() && strBound < strEnd)
+            vBounds.push_back(strBound);
+    }
+    vBounds.push_back(strEnd);
+    return vBounds;
+}
+
+bool CDBWrapper::ParallelScanSerialized(const CDBSnapshot& snapshot, const std::string& strBegin, const std::string& strEnd, int nParts,
+                                        const std::function<bool(int, std::unique_ptr<CDBIterator>)>& fn) const
+{
+    std::vector<std::string> vBounds = SplitKeyRange(strBegin, strEnd, std::max(nParts, 1));
+    size_t nRanges = vBounds.size() - 1;
+    std::vector<char> vSuccess(nRanges, false);
+    std::vector<std::exception_ptr> vErrors(nRanges);
+
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < nRanges; i++) {
+        threads.emplace_back([&, i]() {
+            RenameThread("tcoin-dbscan");
+            try {
+                std::unique_ptr<CDBIterator> it(NewIterator(snapshot));
+                it->piter->Seek(vBounds[i]);
+                it->strUpperBound = vBounds[i + 1];
+                vSuccess[i] = fn(i, std::move(it));
+            } catch (...) {
+                vErrors[i] = std::current_exception();
+            }
+        });
+    }
+    for (std::thread& thread : threads)
+        thread.join();
+
+    for (const std::exception_ptr& error : vErrors) {
+        if (error)
+            std::rethrow_exception(error);
+    }
+    return std::all_of(vSuccess.begin(), vSuccess.end(), [](char fSuccess) { return fSuccess; });
+}
+
+CDBSnapshot::CDBSnapshot(const CDBWrapper &_parent) : parent(_parent), psnapshot(_parent.pdb->GetSnapshot()) { }
+CDBSnapshot::~CDBSnapshot() { parent.pdb->ReleaseSnapshot(psnapshot); }
+
 CDBIterator::~CDBIterator() { delete piter; }
-bool CDBIterator::Valid() { return piter->Valid(); }
+bool CDBIterator::Valid() { return piter->Valid() && (strUpperBound.empty() || piter->key().compare(strUpperBound) < 0); }
 void CDBIterator::SeekToFirst() { piter->SeekToFirst(); }
 void CDBIterator::Next() { piter->Next(); }
 
@@ -12,6 +12,10 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <functional>
+#include <memory>
+#include <string>
+
 #include <boost/filesystem/path.hpp>
 
 #include <leveldb/db.h>
@@ -19,6 +23,38 @@
 
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
+//! Default bits per key of the bloom filter, 0 disables it
+static const int DEFAULT_DB_BLOOM_BITS = 10;
+//! Default approximate size of a table block in bytes (before compression)
+static const size_t DEFAULT_DB_BLOCK_SIZE = 4096;
+//! Default number of table files a database may keep open
+static const int DEFAULT_DB_MAX_OPEN_FILES = 64;
+//! Default for compressing table blocks
+static const bool DEFAULT_DB_COMPRESSION = false;
+
+/** LevelDB settings that can be tuned for every database separately. */
+struct CDBOptions
+{
+    //! Bits per key of the bloom filter kept for every table, which lets a
+    //! lookup of a missing key skip reading the table; 0 for no filter.
+    int nBloomBits;
+    //! Approximate size of the data in a table block, the unit read from disk.
+    size_t nBlockSize;
+    //! Number of table files kept open, beyond which tables are reopened.
+    int nMaxOpenFiles;
+    //! Compress table blocks with Snappy. An open CDBWrapper clears it if
+    //! LevelDB was built without Snappy.
+    bool fCompression;
+
+    CDBOptions() : nBloomBits(DEFAULT_DB_BLOOM_BITS), nBlockSize(DEFAULT_DB_BLOCK_SIZE),
+                   nMaxOpenFiles(DEFAULT_DB_MAX_OPEN_FILES), fCompression(DEFAULT_DB_COMPRESSION) {}
+
+    /**
+     * Set one option by name: "bloombits", "blocksize", "maxopenfiles" or
+     * "compression". Returns false if the name or the value is invalid.
+     */
+    bool Set(const std::string& strName, const std::string& strValue);
+};
 
 class dbwrapper_error : public std::runtime_error
 {
@@ -56,11 +92,19 @@ private:
     CDataStream ssKey;
     CDataStream ssValue;
 
+    size_t size_estimate;
+
 public:
     /**
      * @param[in] _parent   CDBWrapper that this batch is to be submitted to
      */
-    CDBBatch(const CDBWrapper &_parent) : parent(_parent), ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION) { };
+    CDBBatch(const CDBWrapper &_parent) : parent(_parent), ssKey(SER_DISK, CLIENT_VERSION), ssValue(SER_DISK, CLIENT_VERSION), size_estimate(0) { };
+
+    void Clear()
+    {
+        batch.Clear();
+        size_estimate = 0;
+    }
 
     template <typename K, typename V>
     void Write(const K& key, const V& value)
@@ -75,6 +119,14 @@ public:
         leveldb::Slice slValue(ssValue.data(), ssValue.size());
 
         batch.Put(slKey, slValue);
+        // LevelDB serializes writes as:
+        // - byte: header
+        // - varint: key length (1 byte up to 127B, 2 bytes up to 16383B, ...)
+        // - byte[]: key
+        // - varint: value length
+        // - byte[]: value
+        // The formula below assumes the key and value are both less than 16k.
+        size_estimate += 3 + (slKey.size() > 127) + slKey.size() + (slValue.size() > 127) + slValue.size();
         ssKey.clear();
         ssValue.clear();
     }
@@ -87,15 +139,44 @@ public:
         leveldb::Slice slKey(ssKey.data(), ssKey.size());
 
         batch.Delete(slKey);
+        // LevelDB serializes erases as:
+        // - byte: header
+        // - varint: key length
+        // - byte[]: key
+        // The formula below assumes the key is less than 16kB.
+        size_estimate += 2 + (slKey.size() > 127) + slKey.size();
         ssKey.clear();
     }
+
+    size_t SizeEstimate() const { return size_estimate; }
+};
+
+/** A consistent view of a CDBWrapper as of its creation, for iterators to read from. */
+class CDBSnapshot
+{
+    friend class CDBWrapper;
+
+private:
+    const CDBWrapper &parent;
+    const leveldb::Snapshot *psnapshot;
+
+    CDBSnapshot(const CDBSnapshot&);
+    void operator=(const CDBSnapshot&);
+
+public:
+    explicit CDBSnapshot(const CDBWrapper &_parent);
+    ~CDBSnapshot();
 };
 
 class CDBIterator
 {
+    friend class CDBWrapper;
+
 private:
     const CDBWrapper &parent;
     leveldb::Iterator *piter;
+    //! serialized key before which the iteration ends, unless empty
+    std::string strUpperBound;
 
 public:
 
@@ -157,10 +238,14 @@ public:
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
+    friend class CDBSnapshot;
 private:
     //! custom environment this database is using (may be NULL in case of default environment)
     leveldb::Env* penv;
 
+    //! tunable options the database was opened with
+    CDBOptions dbopts;
+
     //! database options used
     leveldb::Options options;
 
@@ -190,6 +275,9 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+    bool ParallelScanSerialized(const CDBSnapshot& snapshot, const std::string& strBegin, const std::string& strEnd, int nParts,
+                                const std::function<bool(int, std::unique_ptr<CDBIterator>)>& fn) const;
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -198,8 +286,9 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] _dbopts     Bloom filter, block size, open files and compression settings.
      */
-    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const CDBOptions& _dbopts = CDBOptions());
     ~CDBWrapper();
 
     template <typename K, typename V>
@@ -282,10 +371,54 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /** Return an iterator that reads from the given snapshot. */
+    CDBIterator *NewIterator(const CDBSnapshot& snapshot) const;
+
+    /**
+     * Scan the keys in [key_begin, key_end) with up to nParts iterators, each
+     * over its own part of the range and on its own thread. They all read
+     * from snapshot. The range is split by interpolating between the two
+     * keys, which gives parts of similar size when the keys are spread
+     * evenly, like the txids in the chainstate.
+     *
+     * fn(part, it) gets an iterator positioned at the start of the part,
+     * which stops being Valid() at its end. Parts are numbered in key order,
+     * so per-part results can be merged in order afterwards. Returns whether
+     * fn succeeded for all parts. An exception thrown by fn is rethrown once
+     * all threads have finished.
+     */
+    template<typename K>
+    bool ParallelScan(const CDBSnapshot& snapshot, const K& key_begin, const K& key_end, int nParts,
+                      const std::function<bool(int, std::unique_ptr<CDBIterator>)>& fn) const
+    {
+        CDataStream ssKey1(SER_DISK, CLIENT_VERSION), ssKey2(SER_DISK, CLIENT_VERSION);
+        ssKey1 << key_begin;
+        ssKey2 << key_end;
+        return ParallelScanSerialized(snapshot, ssKey1.str(), ssKey2.str(), nParts, fn);
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
     bool IsEmpty();
+
+    const CDBOptions& GetDBOptions() const { return dbopts; }
+
+    /**
+     * Compact the underlying storage for the key range [key_begin, key_end].
+     */
+    template<typename K>
+    void CompactRange(const K& key_begin, const K& key_end) const
+    {
+        CDataStream ssKey1(SER_DISK, CLIENT_VERSION), ssKey2(SER_DISK, CLIENT_VERSION);
+        ssKey1.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey2.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
+        ssKey1 << key_begin;
+        ssKey2 << key_end;
+        leveldb::Slice slKey1(ssKey1.data(), ssKey1.size());
+        leveldb::Slice slKey2(ssKey2.data(), ssKey2.size());
+        pdb->CompactRange(&slKey1, &slKey2);
+    }
 };
 
 #endif // TCOIN_DBWRAPPER_H
@@ -8,6 +8,7 @@
 
 #include "crypto/ripemd160.h"
 #include "crypto/sha256.h"
+#include "crypto/x17.h"
 #include "prevector.h"
 #include "serialize.h"
 #include "uint256.h"
@@ -35,63 +36,6 @@
 
 typedef uint256 ChainCode;
 
-#ifdef GLOBALDEFINED
-#define GLOBAL
-#else
-#define GLOBAL extern
-#endif
-
-GLOBAL sph_blake512_context     z_blake;
-GLOBAL sph_bmw512_context       z_bmw;
-GLOBAL sph_groestl512_context   z_groestl;
-GLOBAL sph_jh512_context        z_jh;
-GLOBAL sph_keccak512_context    z_keccak;
-GLOBAL sph_skein512_context     z_skein;
-GLOBAL sph_luffa512_context     z_luffa;
-GLOBAL sph_cubehash512_context  z_cubehash;
-GLOBAL sph_shavite512_context   z_shavite;
-GLOBAL sph_simd512_context      z_simd;
-GLOBAL sph_echo512_context      z_echo;
-GLOBAL sph_hamsi512_context     z_hamsi;
-GLOBAL sph_fugue512_context     z_fugue;
-GLOBAL sph_shabal512_context    z_shabal;
-GLOBAL sph_whirlpool_context    z_whirlpool;
-GLOBAL sph_sha512_context       z_sha2;
-GLOBAL sph_haval256_5_context   z_haval;
-
-#define fillz() do { \
-    sph_blake512_init(&z_blake); \
-    sph_bmw512_init(&z_bmw); \
-    sph_groestl512_init(&z_groestl); \
-    sph_jh512_init(&z_jh); \
-    sph_keccak512_init(&z_keccak); \
-    sph_skein512_init(&z_skein); \
-    sph_luffa512_init(&z_luffa); \
-    sph_cubehash512_init(&z_cubehash); \
-    sph_shavite512_init(&z_shavite); \
-    sph_simd512_init(&z_simd); \
-    sph_echo512_init(&z_echo); \
-    sph_hamsi512_init(&z_hamsi); \
-    sph_fugue512_init(&z_fugue); \
-    sph_shabal512_init(&z_shabal); \
-    sph_whirlpool_init(&z_whirlpool); \
-    sph_sha512_init(&z_sha2); \
-    sph_haval256_5_init(&z_haval); \
-} while (0) 
-
-#define ZBLAKE (memcpy(&ctx_blake, &z_blake, sizeof(z_blake)))
-#define ZBMW (memcpy(&ctx_bmw, &z_bmw, sizeof(z_bmw)))
-#define ZGROESTL (memcpy(&ctx_groestl, &z_groestl, sizeof(z_groestl)))
-#define ZJH (memcpy(&ctx_jh, &z_jh, sizeof(z_jh)))
-#define ZKECCAK (memcpy(&ctx_keccak, &z_keccak, sizeof(z_keccak)))
-#define ZSKEIN (memcpy(&ctx_skein, &z_skein, sizeof(z_skein)))
-#define ZHAMSI (memcpy(&ctx_hamsi, &z_hamsi, sizeof(z_hamsi)))
-#define ZFUGUE (memcpy(&ctx_fugue, &z_fugue, sizeof(z_fugue)))
-#define ZSHABAL (memcpy(&ctx_shabal, &z_shabal, sizeof(z_shabal)))
-#define ZWHIRLPOOL (memcpy(&ctx_whirlpool, &z_whirlpool, sizeof(z_whirlpool)))
-#define ZSHA2 (memcpy(&ctx_sha2, &z_sha2, sizeof(z_sha2)))
-#define ZHAVAL (memcpy(&ctx_haval, &z_haval, sizeof(z_haval)))
-
 /** A hasher class for Tcoin's 256-bit hash (double SHA-256). */
 class CHash256 {
 private:
@@ -281,100 +225,97 @@ public:
  *      .Finalize()
  */
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
+uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
+
+/** The sph contexts of the X17 stages that HashX17 runs through sph, in
+ *  their freshly initialized state. HashX17 copies these instead of calling
+ *  the init functions on every hash. */
+struct CX17Contexts
+{
+    sph_blake512_context blake;
+    sph_bmw512_context bmw;
+    sph_skein512_context skein;
+    sph_jh512_context jh;
+    sph_keccak512_context keccak;
+    sph_luffa512_context luffa;
+    sph_cubehash512_context cubehash;
+    sph_simd512_context simd;
+    sph_hamsi512_context hamsi;
+    sph_fugue512_context fugue;
+    sph_shabal512_context shabal;
+    sph_whirlpool_context whirlpool;
+    sph_sha512_context sha512;
+    sph_haval256_5_context haval;
+
+    CX17Contexts()
+    {
+        sph_blake512_init(&blake);
+        sph_bmw512_init(&bmw);
+        sph_skein512_init(&skein);
+        sph_jh512_init(&jh);
+        sph_keccak512_init(&keccak);
+        sph_luffa512_init(&luffa);
+        sph_cubehash512_init(&cubehash);
+        sph_simd512_init(&simd);
+        sph_hamsi512_init(&hamsi);
+        sph_fugue512_init(&fugue);
+        sph_shabal512_init(&shabal);
+        sph_whirlpool_init(&whirlpool);
+        sph_sha512_init(&sha512);
+        sph_haval256_5_init(&haval);
+    }
+};
+
+/** Initialized once, on first use, and never written to afterwards. */
+inline const CX17Contexts& X17InitialContexts()
+{
+    static const CX17Contexts contexts;
+    return contexts;
+}
+
+/** Run one sph stage of HashX17, starting from an initialized context. */
+template<typename Ctx, void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+inline void HashX17Stage(const Ctx& initial, void* out, const void* in, size_t len)
+{
+    Ctx ctx;
+    memcpy(&ctx, &initial, sizeof(ctx));
+    Update(&ctx, in, len);
+    Close(&ctx, out);
+}
 
 template<typename T1>
 inline uint256 HashX17(const T1 pbegin, const T1 pend)
 {
-    sph_blake512_context      ctx_blake;
-    sph_bmw512_context        ctx_bmw;
-    sph_groestl512_context    ctx_groestl;
-    sph_jh512_context         ctx_jh;
-    sph_keccak512_context     ctx_keccak;
-    sph_skein512_context      ctx_skein;
-    sph_luffa512_context      ctx_luffa;
-    sph_cubehash512_context   ctx_cubehash;
-    sph_shavite512_context    ctx_shavite;
-    sph_simd512_context       ctx_simd;
-    sph_echo512_context       ctx_echo;
-    sph_hamsi512_context      ctx_hamsi;
-    sph_fugue512_context      ctx_fugue;
-    sph_shabal512_context     ctx_shabal;
-    sph_whirlpool_context     ctx_whirlpool;
-    sph_sha512_context        ctx_sha2;
-    sph_haval256_5_context    ctx_haval;
-static unsigned char pblank[1];
-
-    uint512 hash[17];
-
-    sph_blake512_init(&ctx_blake);
-    sph_blake512 (&ctx_blake, (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0])), (pend - pbegin) * sizeof(pbegin[0]));
-    sph_blake512_close(&ctx_blake, static_cast<void*>(&hash[0]));
-    
-    sph_bmw512_init(&ctx_bmw);
-    sph_bmw512 (&ctx_bmw, static_cast<const void*>(&hash[0]), 64);
-    sph_bmw512_close(&ctx_bmw, static_cast<void*>(&hash[1]));
-
-    sph_groestl512_init(&ctx_groestl);
-    sph_groestl512 (&ctx_groestl, static_cast<const void*>(&hash[1]), 64);
-    sph_groestl512_close(&ctx_groestl, static_cast<void*>(&hash[2]));
-
-    sph_skein512_init(&ctx_skein);
-    sph_skein512 (&ctx_skein, static_cast<const void*>(&hash[2]), 64);
-    sph_skein512_close(&ctx_skein, static_cast<void*>(&hash[3]));
-    
-    sph_jh512_init(&ctx_jh);
-    sph_jh512 (&ctx_jh, static_cast<const void*>(&hash[3]), 64);
-    sph_jh512_close(&ctx_jh, static_cast<void*>(&hash[4]));
-    
-    sph_keccak512_init(&ctx_keccak);
-    sph_keccak512 (&ctx_keccak, static_cast<const void*>(&hash[4]), 64);
-    sph_keccak512_close(&ctx_keccak, static_cast<void*>(&hash[5]));
-
-    sph_luffa512_init(&ctx_luffa);
-    sph_luffa512 (&ctx_luffa, static_cast<void*>(&hash[5]), 64);
-    sph_luffa512_close(&ctx_luffa, static_cast<void*>(&hash[6]));
-    
-    sph_cubehash512_init(&ctx_cubehash);
-    sph_cubehash512 (&ctx_cubehash, static_cast<const void*>(&hash[6]), 64);
-    sph_cubehash512_close(&ctx_cubehash, static_cast<void*>(&hash[7]));
-    
-    sph_shavite512_init(&ctx_shavite);
-    sph_shavite512(&ctx_shavite, static_cast<const void*>(&hash[7]), 64);
-    sph_shavite512_close(&ctx_shavite, static_cast<void*>(&hash[8]));
-        
-    sph_simd512_init(&ctx_simd);
-    sph_simd512 (&ctx_simd, static_cast<const void*>(&hash[8]), 64);
-    sph_simd512_close(&ctx_simd, static_cast<void*>(&hash[9]));
-
-    sph_echo512_init(&ctx_echo);
-    sph_echo512 (&ctx_echo, static_cast<const void*>(&hash[9]), 64);
-    sph_echo512_close(&ctx_echo, static_cast<void*>(&hash[10]));
-
-    sph_hamsi512_init(&ctx_hamsi);
-    sph_hamsi512 (&ctx_hamsi, static_cast<const void*>(&hash[10]), 64);
-    sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(&hash[11]));
-
-    sph_fugue512_init(&ctx_fugue);
-    sph_fugue512 (&ctx_fugue, static_cast<const void*>(&hash[11]), 64);
-    sph_fugue512_close(&ctx_fugue, static_cast<void*>(&hash[12]));
-
-    sph_shabal512_init(&ctx_shabal);
-    sph_shabal512 (&ctx_shabal, static_cast<const void*>(&hash[12]), 64);
-    sph_shabal512_close(&ctx_shabal, static_cast<void*>(&hash[13]));
-
-    sph_whirlpool_init(&ctx_whirlpool);
-    sph_whirlpool (&ctx_whirlpool, static_cast<const void*>(&hash[13]), 64);
-    sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(&hash[14]));
-
-    sph_sha512_init(&ctx_sha2);
-    sph_sha512 (&ctx_sha2, static_cast<const void*>(&hash[14]), 64);
-    sph_sha512_close(&ctx_sha2, static_cast<void*>(&hash[15]));
-
-    sph_haval256_5_init(&ctx_haval);
-    sph_haval256_5 (&ctx_haval, static_cast<const void*>(&hash[15]), 64);
-    sph_haval256_5_close(&ctx_haval, static_cast<void*>(&hash[16]));
-
-    return hash[16].trim256();
+    static const unsigned char pblank[1] = {};
+    const CX17Contexts& z = X17InitialContexts();
+
+    // Every stage reads one half of the buffer and writes the other.
+    unsigned char hash[2 * X17_STAGE_SIZE];
+    unsigned char* a = hash;
+    unsigned char* b = hash + X17_STAGE_SIZE;
+
+    HashX17Stage<sph_blake512_context, sph_blake512, sph_blake512_close>(z.blake, a, (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0])), (pend - pbegin) * sizeof(pbegin[0]));
+    HashX17Stage<sph_bmw512_context, sph_bmw512, sph_bmw512_close>(z.bmw, b, a, X17_STAGE_SIZE);
+    X17Groestl512_64(a, b);
+    HashX17Stage<sph_skein512_context, sph_skein512, sph_skein512_close>(z.skein, b, a, X17_STAGE_SIZE);
+    HashX17Stage<sph_jh512_context, sph_jh512, sph_jh512_close>(z.jh, a, b, X17_STAGE_SIZE);
+    HashX17Stage<sph_keccak512_context, sph_keccak512, sph_keccak512_close>(z.keccak, b, a, X17_STAGE_SIZE);
+    HashX17Stage<sph_luffa512_context, sph_luffa512, sph_luffa512_close>(z.luffa, a, b, X17_STAGE_SIZE);
+    HashX17Stage<sph_cubehash512_context, sph_cubehash512, sph_cubehash512_close>(z.cubehash, b, a, X17_STAGE_SIZE);
+    X17Shavite512_64(a, b);
+    HashX17Stage<sph_simd512_context, sph_simd512, sph_simd512_close>(z.simd, b, a, X17_STAGE_SIZE);
+    X17Echo512_64(a, b);
+    HashX17Stage<sph_hamsi512_context, sph_hamsi512, sph_hamsi512_close>(z.hamsi, b, a, X17_STAGE_SIZE);
+    HashX17Stage<sph_fugue512_context, sph_fugue512, sph_fugue512_close>(z.fugue, a, b, X17_STAGE_SIZE);
+    HashX17Stage<sph_shabal512_context, sph_shabal512, sph_shabal512_close>(z.shabal, b, a, X17_STAGE_SIZE);
+    HashX17Stage<sph_whirlpool_context, sph_whirlpool, sph_whirlpool_close>(z.whirlpool, a, b, X17_STAGE_SIZE);
+    HashX17Stage<sph_sha512_context, sph_sha512, sph_sha512_close>(z.sha512, b, a, X17_STAGE_SIZE);
+    HashX17Stage<sph_haval256_5_context, sph_haval256_5, sph_haval256_5_close>(z.haval, a, b, X17_STAGE_SIZE);
+
+    // HAVAL-256 only fills the first half of its output.
+    uint256 result;
+    memcpy(result.begin(), a, result.size());
+    return result;
 }
 
 #endif // TCOIN_HASH_H
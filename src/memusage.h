@@ -6,11 +6,13 @@
 #define TCOIN_MEMUSAGE_H
 
 #include "indirectmap.h"
+#include "support/allocators/pool.h"
 
 #include <stdlib.h>
 
 #include <map>
 #include <set>
+#include <unordered_map>
 #include <vector>
 
 #include <boost/foreach.hpp>
@@ -167,6 +169,21 @@ static inline size_t DynamicUsage(const boost::unordered_map<X, Y, Z>& m)
     return MallocUsage(sizeof(boost_unordered_node<std::pair<const X, Y> >)) * m.size() + MallocUsage(sizeof(void*) * m.bucket_count());
 }
 
+// Pool-allocated data structures
+
+template<typename Key, typename T, typename Hash, typename Pred, size_t MAX_BLOCK_SIZE_BYTES, size_t ALIGN_BYTES>
+static inline size_t DynamicUsage(const std::unordered_map<Key, T, Hash, Pred, PoolAllocator<std::pair<const Key, T>, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> >& m)
+{
+    // The nodes live in the chunks of the pool resource, which are only
+    // released when the resource is destroyed, so count whole chunks rather
+    // than m.size() nodes. Each chunk is also referenced from the resource's
+    // chunk vector.
+    const PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>* pool_resource = m.get_allocator().resource();
+    size_t usage_resource = MallocUsage(sizeof(void*) * pool_resource->NumAllocatedChunks());
+    size_t usage_chunks = MallocUsage(pool_resource->ChunkSizeBytes()) * pool_resource->NumAllocatedChunks();
+    return usage_resource + usage_chunks + MallocUsage(sizeof(void*) * m.bucket_count());
+}
+
 }
 
 #endif // TCOIN_MEMUSAGE_H
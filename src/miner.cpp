@@ -12,6 +12,8 @@
 #include "consensus/consensus.h"
 #include "consensus/merkle.h"
 #include "consensus/validation.h"
+#include "crypto/common.h"
+#include "crypto/x17.h"
 #include "hash.h"
 #include "validation.h"
 #include "net.h"
@@ -23,9 +25,11 @@
 #include "txmempool.h"
 #include "util.h"
 #include "utilmoneystr.h"
+#include "utilstrencodings.h"
 #include "validationinterface.h"
 
 #include <algorithm>
+#include <boost/bind.hpp>
 #include <boost/thread.hpp>
 #include <boost/tuple/tuple.hpp>
 #include <queue>
@@ -644,3 +648,132 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
     pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
     pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 }
+
+/** Nonces a nonce search worker hashes at a time (one batched X17 lane group) */
+static const unsigned int NONCE_SEARCH_CHUNK = 4;
+/** How many nonces apart the abort callback of a nonce search is polled */
+static const unsigned int NONCE_SEARCH_ABORT_INTERVAL = 4096;
+
+CNonceSearcher::CNonceSearcher(int nThreads) : nHelpers(std::max(nThreads, 1) - 1), nHelpersDone(0), nSearchId(0), fQuit(false)
+{
+    for (int i = 0; i < nHelpers; i++)
+        threadGroup.create_thread(boost::bind(&CNonceSearcher::ThreadHelper, this));
+}
+
+CNonceSearcher::~CNonceSearcher()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        fQuit = true;
+    }
+    condWorker.notify_all();
+    threadGroup.join_all();
+}
+
+void CNonceSearcher::ThreadHelper()
+{
+    RenameThread("tcoin-generate");
+    uint64_t nLastSearchId = 0;
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (!fQuit && nSearchId == nLastSearchId)
+                condWorker.wait(lock);
+            if (fQuit)
+                return;
+            nLastSearchId = nSearchId;
+        }
+        Work();
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            nHelpersDone++;
+        }
+        condMaster.notify_one();
+    }
+}
+
+void CNonceSearcher::Work()
+{
+    // Only the last 16 bytes of the header (the end of hashMerkleRoot, nTime,
+    // nBits and nNonce) differ between tries; the rest is hashed once.
+    const CX17HeaderHasher hasher((const unsigned char*)BEGIN(searchHeader.nVersion));
+    const size_t nNonceOffset = BEGIN(searchHeader.nNonce) - BEGIN(searchHeader.nVersion) - CX17HeaderHasher::PREFIX_SIZE;
+    unsigned char tails[NONCE_SEARCH_CHUNK * CX17HeaderHasher::TAIL_SIZE];
+    unsigned char out[NONCE_SEARCH_CHUNK * X17_OUTPUT_SIZE];
+    for (unsigned int i = 0; i < NONCE_SEARCH_CHUNK; i++)
+        memcpy(tails + i * CX17HeaderHasher::TAIL_SIZE, BEGIN(searchHeader.nVersion) + CX17HeaderHasher::PREFIX_SIZE, CX17HeaderHasher::TAIL_SIZE);
+
+    while (!fStop) {
+        uint64_t nStart = nNextNonce.fetch_add(NONCE_SEARCH_CHUNK);
+        if (nStart >= nSearchEnd)
+            break;
+        if ((nStart / NONCE_SEARCH_CHUNK) % (NONCE_SEARCH_ABORT_INTERVAL / NONCE_SEARCH_CHUNK) == 0 && (*pfnAbort)()) {
+            fAborted = true;
+            fStop = true;
+            break;
+        }
+
+        // Take the tries for this chunk out of the shared budget.
+        uint64_t nCount = std::min<uint64_t>(NONCE_SEARCH_CHUNK, nSearchEnd - nStart);
+        uint64_t nLeft = nTriesLeft.load();
+        while (nLeft > 0 && !nTriesLeft.compare_exchange_weak(nLeft, nLeft - std::min(nCount, nLeft))) {}
+        if (nLeft == 0) {
+            fStop = true;
+            break;
+        }
+        nCount = std::min(nCount, nLeft);
+
+        for (unsigned int i = 0; i < nCount; i++)
+            WriteLE32(tails + i * CX17HeaderHasher::TAIL_SIZE + nNonceOffset, nStart + i);
+        hasher.Hash(out, tails, nCount);
+        for (unsigned int i = 0; i < nCount; i++) {
+            uint256 hash;
+            memcpy(hash.begin(), out + i * X17_OUTPUT_SIZE, X17_OUTPUT_SIZE);
+            if (CheckProofOfWork(hash, searchHeader.nBits, *pparams)) {
+                bool fExpected = false;
+                if (fFound.compare_exchange_strong(fExpected, true))
+                    nFoundNonce = nStart + i;
+                fStop = true;
+                // Like the serial loop, the successful try is not counted.
+                nTriesLeft += nCount - i;
+                break;
+            }
+        }
+    }
+}
+
+CNonceSearcher::Result CNonceSearcher::Search(CBlockHeader& header, uint32_t nNonceEnd, uint64_t& nMaxTries, const Consensus::Params& params, const std::function<bool()>& fnAbort)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        searchHeader = header;
+        nSearchEnd = nNonceEnd;
+        pparams = &params;
+        pfnAbort = &fnAbort;
+        nNextNonce = header.nNonce;
+        nTriesLeft = nMaxTries;
+        fStop = false;
+        fFound = false;
+        fAborted = false;
+        nHelpersDone = 0;
+        nSearchId++;
+    }
+    condWorker.notify_all();
+    Work();
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        while (nHelpersDone < nHelpers)
+            condMaster.wait(lock);
+    }
+
+    nMaxTries = nTriesLeft;
+    if (fFound) {
+        header.nNonce = nFoundNonce;
+        return FOUND;
+    }
+    if (fAborted)
+        return ABORTED;
+    if (nMaxTries == 0)
+        return MAX_TRIES;
+    return EXHAUSTED;
+}
@@ -9,8 +9,13 @@
 #include "primitives/block.h"
 #include "txmempool.h"
 
+#include <atomic>
+#include <functional>
 #include <stdint.h>
 #include <memory>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include "boost/multi_index_container.hpp"
 #include "boost/multi_index/ordered_index.hpp"
 
@@ -23,6 +28,8 @@ class CWallet;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default for -genproclimit, the number of threads searching for a nonce in generate (<= 0: all cores) */
+static const int DEFAULT_GENERATE_THREADS = 0;
 
 struct CBlockTemplate
 {
@@ -209,6 +216,65 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx);
 };
 
+/**
+ * Searches the nonce space of a block header with a pool of worker threads.
+ *
+ * The calling thread takes part in every search, and nThreads - 1 helper
+ * threads live as long as the object does. Workers take small chunks of
+ * consecutive nonces from a shared counter and hash each chunk with the
+ * batched X17 engine, so a search stops soon after a solution is found.
+ */
+class CNonceSearcher
+{
+public:
+    enum Result {
+        FOUND,      //!< header.nNonce is set to a valid nonce
+        EXHAUSTED,  //!< no nonce up to nNonceEnd is valid
+        MAX_TRIES,  //!< the nMaxTries budget ran out first
+        ABORTED,    //!< fnAbort returned true
+    };
+
+    explicit CNonceSearcher(int nThreads);
+    ~CNonceSearcher();
+
+    /**
+     * Try the nonces from header.nNonce up to (excluding) nNonceEnd, at most
+     * nMaxTries of them. nMaxTries is decreased by the number of hashes
+     * computed. fnAbort is polled from the worker threads every few thousand
+     * nonces, and ends the search when it returns true.
+     */
+    Result Search(CBlockHeader& header, uint32_t nNonceEnd, uint64_t& nMaxTries, const Consensus::Params& params, const std::function<bool()>& fnAbort);
+
+private:
+    boost::thread_group threadGroup;
+    boost::mutex mutex;
+    boost::condition_variable condWorker;
+    boost::condition_variable condMaster;
+    //! Number of helper threads
+    int nHelpers;
+    //! Number of helpers that have finished the current search
+    int nHelpersDone;
+    //! Incremented for every search, so that helpers can tell a new one started
+    uint64_t nSearchId;
+    bool fQuit;
+
+    // The current search; written only while no worker is running.
+    CBlockHeader searchHeader;
+    uint32_t nSearchEnd;
+    const Consensus::Params* pparams;
+    const std::function<bool()>* pfnAbort;
+
+    std::atomic<uint64_t> nNextNonce;
+    std::atomic<uint64_t> nTriesLeft;
+    std::atomic<bool> fStop;
+    std::atomic<bool> fFound;
+    std::atomic<bool> fAborted;
+    std::atomic<uint32_t> nFoundNonce;
+
+    void ThreadHelper();
+    void Work();
+};
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
@@ -9,6 +9,7 @@
 #include "tinyformat.h"
 #include "utilstrencodings.h"
 #include "crypto/common.h"
+#include "crypto/x17.h"
 
 uint256 CBlockHeader::GetHash() const
 {
@@ -45,3 +46,17 @@ int64_t GetBlockWeight(const CBlock& block)
     // weight = (stripped_size * 3) + total_size.
     return ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) * (WITNESS_SCALE_FACTOR - 1) + ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
 }
+
+std::vector<uint256> GetPoWHashes(const std::vector<CBlockHeader>& headers)
+{
+    std::vector<unsigned char> data(headers.size() * X17_HEADER_SIZE);
+    for (size_t i = 0; i < headers.size(); i++) {
+        const CBlockHeader& header = headers[i];
+        memcpy(&data[i * X17_HEADER_SIZE], BEGIN(header.nVersion), X17_HEADER_SIZE);
+    }
+    std::vector<uint256> ret(headers.size());
+    if (!headers.empty()) {
+        X17HashHeaders(ret[0].begin(), data.data(), headers.size());
+    }
+    return ret;
+}
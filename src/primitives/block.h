@@ -160,4 +160,7 @@ struct CBlockLocator
 /** Compute the consensus-critical block weight (see BIP 141). */
 int64_t GetBlockWeight(const CBlock& tx);
 
+/** Compute GetPoWHash() for a batch of headers at once (see X17HashHeaders). */
+std::vector<uint256> GetPoWHashes(const std::vector<CBlockHeader>& headers);
+
 #endif // TCOIN_PRIMITIVES_BLOCK_H
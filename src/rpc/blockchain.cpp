@@ -4,30 +4,41 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "amount.h"
+#include "base58.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
+#include "clientversion.h"
 #include "coins.h"
 #include "consensus/validation.h"
+#include "init.h"
 #include "validation.h"
 #include "policy/policy.h"
 #include "primitives/transaction.h"
+#include "random.h"
 #include "rpc/server.h"
+#include "script/standard.h"
 #include "streams.h"
 #include "sync.h"
+#include "txdb.h"
 #include "txmempool.h"
 #include "util.h"
 #include "utilstrencodings.h"
+#include "utxosnapshot.h"
 #include "hash.h"
 
 #include <stdint.h>
 
 #include <univalue.h>
 
+#include <boost/assign/list_of.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/thread/thread.hpp> // boost::thread::interrupt
 
+#include <atomic>
 #include <mutex>
 #include <condition_variable>
+#include <unordered_set>
 using namespace std;
 
 struct CUpdatedBlock
@@ -773,11 +784,24 @@ struct CCoinsStats
     CCoinsStats() : nHeight(0), nTransactions(0), nTransactionOutputs(0), nSerializedSize(0), nTotalAmount(0) {}
 };
 
-//! Calculate statistics about the unspent transaction output set
-static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
+static void ApplyStats(CCoinsStats &stats, CHashWriter& ss, const uint256& hash, const std::map<uint32_t, Coin>& outputs)
 {
-    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+    assert(!outputs.empty());
+    ss << hash;
+    ss << VARINT(outputs.begin()->second.nHeight * 2 + outputs.begin()->second.fCoinBase);
+    stats.nTransactions++;
+    for (const auto& output : outputs) {
+        ss << VARINT(output.first + 1);
+        ss << output.second.out;
+        stats.nTransactionOutputs++;
+        stats.nTotalAmount += output.second.out.nValue;
+    }
+    ss << VARINT(0);
+}
 
+//! Calculate statistics about the unspent transaction output set seen by a cursor
+static bool GetUTXOStats(CCoinsViewCursor *pcursor, CCoinsStats &stats)
+{
     CHashWriter ss(SER_GETHASH, PROTOCOL_VERSION);
     stats.hashBlock = pcursor->GetBestBlock();
     {
@@ -785,32 +809,28 @@ static bool GetUTXOStats(CCoinsView *view, CCoinsStats &stats)
         stats.nHeight = mapBlockIndex.find(stats.hashBlock)->second->nHeight;
     }
     ss << stats.hashBlock;
-    CAmount nTotalAmount = 0;
+    uint256 prevkey;
+    std::map<uint32_t, Coin> outputs;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
-        uint256 key;
-        CCoins coins;
-        if (pcursor->GetKey(key) && pcursor->GetValue(coins)) {
-            stats.nTransactions++;
-            ss << key;
-            for (unsigned int i=0; i<coins.vout.size(); i++) {
-                const CTxOut &out = coins.vout[i];
-                if (!out.IsNull()) {
-                    stats.nTransactionOutputs++;
-                    ss << VARINT(i+1);
-                    ss << out;
-                    nTotalAmount += out.nValue;
-                }
+        COutPoint key;
+        Coin coin;
+        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+            if (!outputs.empty() && key.hash != prevkey) {
+                ApplyStats(stats, ss, prevkey, outputs);
+                outputs.clear();
             }
+            prevkey = key.hash;
+            outputs[key.n] = std::move(coin);
             stats.nSerializedSize += 32 + pcursor->GetValueSize();
-            ss << VARINT(0);
         } else {
             return error("%s: unable to read value", __func__);
         }
         pcursor->Next();
     }
+    if (!outputs.empty())
+        ApplyStats(stats, ss, prevkey, outputs);
     stats.hashSerialized = ss.GetHash();
-    stats.nTotalAmount = nTotalAmount;
     return true;
 }
 
@@ -865,44 +885,453 @@ UniValue pruneblockchain(const JSONRPCRequest& request)
 
 UniValue gettxoutsetinfo(const JSONRPCRequest& request)
 {
-    if (request.fHelp || request.params.size() != 0)
+    if (request.fHelp || request.params.size() > 1)
         throw runtime_error(
-            "gettxoutsetinfo\n"
+            "gettxoutsetinfo ( \"hash_type\" )\n"
             "\nReturns statistics about the unspent transaction output set.\n"
-            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"hash_type\"  (string, optional, default=\"muhash\") Which UTXO set hash to return, \"muhash\" or \"hash_serialized\".\n"
+            "                The MuHash and the other statistics are maintained as blocks are connected, so they are\n"
+            "                returned instantly. hash_serialized also returns the fields marked below, which need a scan\n"
+            "                of the whole set and may take some time.\n"
             "\nResult:\n"
             "{\n"
             "  \"height\":n,     (numeric) The current block height (index)\n"
             "  \"bestblock\": \"hex\",   (string) the best block hash hex\n"
-            "  \"transactions\": n,      (numeric) The number of transactions\n"
             "  \"txouts\": n,            (numeric) The number of output transactions\n"
-            "  \"bytes_serialized\": n,  (numeric) The serialized size\n"
-            "  \"hash_serialized\": \"hash\",   (string) The serialized hash\n"
-            "  \"total_amount\": x.xxx          (numeric) The total amount\n"
+            "  \"bogosize\": n,          (numeric) A database-independent metric for UTXO set size\n"
+            "  \"muhash\": \"hash\",      (string) The MuHash3072 of the UTXO set\n"
+            "  \"total_amount\": x.xxx, (numeric) The total amount\n"
+            "  \"transactions\": n,      (numeric) The number of transactions (hash_serialized only)\n"
+            "  \"bytes_serialized\": n,  (numeric) The serialized size (hash_serialized only)\n"
+            "  \"hash_serialized\": \"hash\"   (string) The serialized hash (hash_serialized only)\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("gettxoutsetinfo", "")
+            + HelpExampleCli("gettxoutsetinfo", "\"hash_serialized\"")
             + HelpExampleRpc("gettxoutsetinfo", "")
         );
 
+    std::string strHashType = request.params.size() > 0 ? request.params[0].get_str() : "muhash";
+    if (strHashType != "muhash" && strHashType != "hash_serialized")
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown hash_type " + strHashType);
+    bool fSerialized = strHashType == "hash_serialized";
+
     UniValue ret(UniValue::VOBJ);
 
-    CCoinsStats stats;
-    FlushStateToDisk();
-    if (GetUTXOStats(pcoinsTip, stats)) {
-        ret.push_back(Pair("height", (int64_t)stats.nHeight));
-        ret.push_back(Pair("bestblock", stats.hashBlock.GetHex()));
+    // For hash_serialized, the cursor is opened under cs_main right after the
+    // cache is written out, so the scan sees the same coins as the commitment.
+    CCoinsCommitment commitment;
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    {
+        LOCK(cs_main);
+        if (fSerialized) {
+            SyncStateToDisk();
+            pcursor.reset(pcoinsTip->Cursor());
+        }
+        if (!pcoinsTip->GetCommitment(commitment))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "UTXO set commitment is not available");
+        uint256 hashBlock = pcoinsTip->GetBestBlock();
+        ret.push_back(Pair("height", (int64_t)mapBlockIndex.find(hashBlock)->second->nHeight));
+        ret.push_back(Pair("bestblock", hashBlock.GetHex()));
+    }
+    ret.push_back(Pair("txouts", commitment.nTransactionOutputs));
+    ret.push_back(Pair("bogosize", commitment.nBogoSize));
+    ret.push_back(Pair("muhash", commitment.GetHash().GetHex()));
+    ret.push_back(Pair("total_amount", ValueFromAmount(commitment.nTotalAmount)));
+
+    if (fSerialized) {
+        CCoinsStats stats;
+        if (!GetUTXOStats(pcursor.get(), stats))
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
         ret.push_back(Pair("transactions", (int64_t)stats.nTransactions));
-        ret.push_back(Pair("txouts", (int64_t)stats.nTransactionOutputs));
         ret.push_back(Pair("bytes_serialized", (int64_t)stats.nSerializedSize));
         ret.push_back(Pair("hash_serialized", stats.hashSerialized.GetHex()));
-        ret.push_back(Pair("total_amount", ValueFromAmount(stats.nTotalAmount)));
-    } else {
-        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read UTXO set");
     }
     return ret;
 }
 
+UniValue dumptxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 1)
+        throw runtime_error(
+            "dumptxoutset \"path\"\n"
+            "\nWrites the unspent transaction output set to a snapshot file that loadtxoutset can bootstrap a new node from.\n"
+            "Note this call may take some time.\n"
+            "\nArguments:\n"
+            "1. \"path\"       (string, required) The file to write, relative to the data directory. It must not exist yet.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_written\": n,    (numeric) The number of unspent outputs written\n"
+            "  \"base_hash\": \"hash\",   (string) The block the snapshot was taken at\n"
+            "  \"base_height\": n,      (numeric) The height of that block\n"
+            "  \"muhash\": \"hash\",      (string) The MuHash of the unspent outputs, to pass to loadtxoutset\n"
+            "  \"path\": \"path\"         (string) The absolute path of the snapshot\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("dumptxoutset", "\"utxo.dat\"")
+            + HelpExampleRpc("dumptxoutset", "\"utxo.dat\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(request.params[0].get_str(), GetDataDir());
+    boost::filesystem::path pathTmp = path.string() + ".incomplete";
+    if (boost::filesystem::exists(path))
+        throw JSONRPCError(RPC_INVALID_PARAMETER, path.string() + " already exists");
+
+    // Writing out the cache and taking the database snapshot under cs_main
+    // makes the snapshot see the coins database exactly at its best block;
+    // reading it needs no lock. The cache stays warm.
+    std::unique_ptr<CDBSnapshot> psnapshot;
+    CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        SyncStateToDisk();
+        psnapshot.reset(pcoinsdbview->NewSnapshot());
+        pindex = mapBlockIndex.find(pcoinsTip->GetBestBlock())->second;
+    }
+
+    CAutoFile fileout(fopen(pathTmp.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    if (fileout.IsNull())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Cannot open " + pathTmp.string() + " for writing");
+    CUTXOSnapshotMetadata metadata(Params().MessageStart(), pindex->GetBlockHash(), pindex->nChainTx);
+    uint64_t nCoins;
+    uint256 hashUTXOSet;
+    bool fWritten = false;
+    try {
+        fWritten = DumpUTXOSnapshot(fileout, *pcoinsdbview, *psnapshot, std::max(GetNumCores(), 1), metadata, nCoins, hashUTXOSet);
+        if (fWritten)
+            FileCommit(fileout.Get());
+    } catch (const std::exception& e) {
+        LogPrintf("%s: error writing %s: %s\n", __func__, pathTmp.string(), e.what());
+    }
+    fileout.fclose();
+    if (!fWritten || !RenameOver(pathTmp, path)) {
+        try {
+            boost::filesystem::remove(pathTmp);
+        } catch (const boost::filesystem::filesystem_error& e) {
+            LogPrintf("%s: Unable to remove %s: %s\n", __func__, pathTmp.string(), e.what());
+        }
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to write UTXO snapshot to " + path.string());
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("coins_written", (int64_t)nCoins));
+    ret.push_back(Pair("base_hash", pindex->GetBlockHash().GetHex()));
+    ret.push_back(Pair("base_height", pindex->nHeight));
+    ret.push_back(Pair("muhash", hashUTXOSet.GetHex()));
+    ret.push_back(Pair("path", path.string()));
+    return ret;
+}
+
+UniValue loadtxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 2)
+        throw runtime_error(
+            "loadtxoutset \"path\" \"muhash\"\n"
+            "\nLoads a snapshot written by dumptxoutset into the empty chainstate of a new node, and continues syncing from its base block.\n"
+            "The block headers up to that block must be known already. Blocks below it are neither downloaded nor validated;\n"
+            "restarting with -reindex-chainstate discards the snapshot and validates the full chain.\n"
+            "\nArguments:\n"
+            "1. \"path\"       (string, required) The snapshot file, relative to the data directory\n"
+            "2. \"muhash\"     (string, required) The MuHash of the UTXO set at the snapshot base block, as reported by\n"
+            "                  dumptxoutset or by gettxoutsetinfo \"muhash\" on a node you trust. The snapshot is rejected\n"
+            "                  before any coins are written if its outputs do not hash to this value.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"coins_loaded\": n,     (numeric) The number of unspent outputs loaded\n"
+            "  \"base_hash\": \"hash\",   (string) The block the snapshot was taken at\n"
+            "  \"base_height\": n       (numeric) The height of that block\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("loadtxoutset", "\"utxo.dat\" \"17f95e3b95d2e43c19694eb00618ee1080408a77d64db47f6f744a03ae331d75\"")
+            + HelpExampleRpc("loadtxoutset", "\"utxo.dat\", \"17f95e3b95d2e43c19694eb00618ee1080408a77d64db47f6f744a03ae331d75\"")
+        );
+
+    boost::filesystem::path path = boost::filesystem::absolute(request.params[0].get_str(), GetDataDir());
+    uint256 hashExpected = ParseHashV(request.params[1], "muhash");
+
+    CValidationState state;
+    uint64_t nCoins;
+    if (!LoadUTXOSnapshot(state, Params(), path, hashExpected, nCoins))
+        throw JSONRPCError(RPC_MISC_ERROR, "Unable to load UTXO snapshot: " + state.GetRejectReason());
+
+    UniValue ret(UniValue::VOBJ);
+    {
+        LOCK(cs_main);
+        ret.push_back(Pair("coins_loaded", (int64_t)nCoins));
+        ret.push_back(Pair("base_hash", pindexSnapshotBase->GetBlockHash().GetHex()));
+        ret.push_back(Pair("base_height", pindexSnapshotBase->nHeight));
+    }
+
+    // Connect the blocks above the base that were downloaded already.
+    if (!ActivateBestChain(state, Params()))
+        throw JSONRPCError(RPC_DATABASE_ERROR, state.GetRejectReason());
+
+    return ret;
+}
+
+static UniValue DBOptionsToJSON(const CDBOptions& dbopts)
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("bloom_bits", dbopts.nBloomBits));
+    ret.push_back(Pair("block_size", (uint64_t)dbopts.nBlockSize));
+    ret.push_back(Pair("max_open_files", dbopts.nMaxOpenFiles));
+    ret.push_back(Pair("compression", dbopts.fCompression));
+    return ret;
+}
+
+UniValue getdbinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw runtime_error(
+            "getdbinfo\n"
+            "\nReturns the LevelDB options of the chainstate and block index databases, see -dboption.\n"
+            "The transaction index (-txindex) is stored in the block index database.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"chainstate\": {\n"
+            "    \"bloom_bits\": n,         (numeric) Bloom filter bits per key, 0 if there is no filter\n"
+            "    \"block_size\": n,         (numeric) Approximate size of a table block in bytes\n"
+            "    \"max_open_files\": n,     (numeric) Number of table files kept open\n"
+            "    \"compression\": true|false (boolean) Whether table blocks are compressed\n"
+            "  },\n"
+            "  \"blockindex\": {\n"
+            "    ...                      Same fields as chainstate\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getdbinfo", "")
+            + HelpExampleRpc("getdbinfo", "")
+        );
+
+    LOCK(cs_main);
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("chainstate", DBOptionsToJSON(pcoinsdbview->GetDBOptions())));
+    ret.push_back(Pair("blockindex", DBOptionsToJSON(pblocktree->GetDBOptions())));
+    return ret;
+}
+
+/** Hashes scripts with a random key, so the target set cannot be made to collide. */
+class SaltedScriptHasher
+{
+private:
+    const uint64_t k0, k1;
+
+public:
+    SaltedScriptHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+    size_t operator()(const CScript& script) const {
+        return CSipHasher(k0, k1).Write(script.data(), script.size()).Finalize();
+    }
+};
+
+static std::atomic<bool> g_scan_in_progress(false);
+static std::atomic<bool> g_should_abort_scan(false);
+static std::atomic<int> g_scan_progress(0);
+
+/** Allows only one scantxoutset at a time. */
+class CCoinsViewScanReserver
+{
+private:
+    bool fReserved;
+
+    CCoinsViewScanReserver(const CCoinsViewScanReserver&);
+    void operator=(const CCoinsViewScanReserver&);
+
+public:
+    CCoinsViewScanReserver() : fReserved(false) {}
+
+    bool Reserve() {
+        assert(!fReserved);
+        bool fExpected = false;
+        if (!g_scan_in_progress.compare_exchange_strong(fExpected, true))
+            return false;
+        fReserved = true;
+        return true;
+    }
+
+    ~CCoinsViewScanReserver() {
+        if (fReserved)
+            g_scan_in_progress = false;
+    }
+};
+
+UniValue scantxoutset(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw runtime_error(
+            "scantxoutset \"action\" ( [scanobjects,...] )\n"
+            "\nScans the unspent transaction output set for outputs paying to any of the given addresses or scripts,\n"
+            "without importing them into a wallet or rescanning the block chain.\n"
+            "The scan runs on several threads and can be followed and aborted from other RPC calls while it runs.\n"
+            "\nArguments:\n"
+            "1. \"action\"                    (string, required) The action to execute\n"
+            "                                      \"start\" for starting a scan\n"
+            "                                      \"abort\" for aborting the current scan (returns true when abort was successful)\n"
+            "                                      \"status\" for progress report (in %) of the current scan\n"
+            "2. \"scanobjects\"               (array, required for \"start\") Array of scan objects\n"
+            "    [                          Every scan object is either a string or an object\n"
+            "      \"address\",               (string) A tcoin address\n"
+            "      {\n"
+            "        \"script\": \"hex\"        (string) A raw scriptPubKey\n"
+            "      },\n"
+            "      ...\n"
+            "    ]\n"
+            "\nResult (\"start\"):\n"
+            "{\n"
+            "  \"success\": true|false,       (boolean) Whether the scan was completed\n"
+            "  \"searched_items\": n,         (numeric) The number of unspent outputs scanned\n"
+            "  \"bestblock\": \"hash\",         (string) The block the unspent output set was scanned at\n"
+            "  \"height\": n,                 (numeric) The height of that block\n"
+            "  \"unspents\": [\n"
+            "    {\n"
+            "      \"txid\": \"hash\",          (string) The transaction id\n"
+            "      \"vout\": n,               (numeric) The output number\n"
+            "      \"scriptPubKey\": \"hex\",   (string) The script of the output\n"
+            "      \"amount\": x.xxx,         (numeric) The amount in " + CURRENCY_UNIT + "\n"
+            "      \"height\": n              (numeric) The height of the block that created the output\n"
+            "    }\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"total_amount\": x.xxx        (numeric) The total amount of all found unspent outputs in " + CURRENCY_UNIT + "\n"
+            "}\n"
+            "\nResult (\"status\"):\n"
+            "{\n"
+            "  \"progress\": n                (numeric) The approximate progress of the current scan in %, or null if none is running\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("scantxoutset", "start \"[\\\"myaddress\\\",{\\\"script\\\":\\\"76a914...88ac\\\"}]\"")
+            + HelpExampleCli("scantxoutset", "status")
+            + HelpExampleRpc("scantxoutset", "\"abort\"")
+        );
+
+    RPCTypeCheck(request.params, boost::assign::list_of(UniValue::VSTR)(UniValue::VARR));
+
+    UniValue result(UniValue::VOBJ);
+    const std::string& strAction = request.params[0].get_str();
+    if (strAction == "status") {
+        CCoinsViewScanReserver reserver;
+        if (reserver.Reserve()) {
+            // no scan in progress
+            return NullUniValue;
+        }
+        result.push_back(Pair("progress", g_scan_progress.load()));
+        return result;
+    } else if (strAction == "abort") {
+        CCoinsViewScanReserver reserver;
+        if (reserver.Reserve()) {
+            // reserve was possible which means no scan was running
+            return false;
+        }
+        // set the abort flag
+        g_should_abort_scan = true;
+        return true;
+    } else if (strAction != "start") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid command " + strAction);
+    }
+
+    if (request.params.size() < 2)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "scanobjects argument is required for the start action");
+
+    std::unordered_set<CScript, SaltedScriptHasher> setScripts;
+    const UniValue& scanobjects = request.params[1].get_array();
+    for (unsigned int i = 0; i < scanobjects.size(); i++) {
+        const UniValue& scanobject = scanobjects[i];
+        if (scanobject.isStr()) {
+            CTcoinAddress address(scanobject.get_str());
+            if (!address.IsValid())
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address " + scanobject.get_str());
+            setScripts.insert(GetScriptForDestination(address.Get()));
+        } else if (scanobject.isObject()) {
+            RPCTypeCheckObj(scanobject, { {"script", UniValueType(UniValue::VSTR)} });
+            std::vector<unsigned char> script = ParseHexO(scanobject, "script");
+            setScripts.insert(CScript(script.begin(), script.end()));
+        } else {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Scan object must be a string or an object");
+        }
+    }
+
+    CCoinsViewScanReserver reserver;
+    if (!reserver.Reserve())
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Scan already in progress, use action \"abort\" or \"status\"");
+    g_scan_progress = 0;
+    g_should_abort_scan = false;
+
+    // As in dumptxoutset, the snapshot taken under cs_main right after the
+    // cache is written out shows the coins database exactly at its best
+    // block; scanning it needs no lock.
+    std::unique_ptr<CDBSnapshot> psnapshot;
+    CBlockIndex* pindex;
+    {
+        LOCK(cs_main);
+        SyncStateToDisk();
+        psnapshot.reset(pcoinsdbview->NewSnapshot());
+        pindex = mapBlockIndex.find(pcoinsTip->GetBestBlock())->second;
+    }
+
+    // Every part covers an equal share of the txid space, so the first two
+    // bytes of the current txid tell how far along it is.
+    const int nParts = std::max(GetNumCores(), 1);
+    std::vector<std::vector<std::pair<COutPoint, Coin> > > vFound(nParts);
+    std::unique_ptr<std::atomic<int>[]> vProgress(new std::atomic<int>[nParts]);
+    std::atomic<int64_t> nSearched(0);
+    for (int part = 0; part < nParts; part++)
+        vProgress[part] = 0;
+    bool fOk = pcoinsdbview->ParallelScan(*psnapshot, nParts, [&](int part, CCoinsViewCursor& cursor) {
+        int64_t count = 0;
+        while (cursor.Valid()) {
+            COutPoint key;
+            Coin coin;
+            if (!cursor.GetKey(key) || !cursor.GetValue(coin))
+                return false;
+            if (count++ % 8192 == 0) {
+                if (g_should_abort_scan || ShutdownRequested())
+                    return false;
+                uint32_t high = 0x100 * *key.hash.begin() + *(key.hash.begin() + 1);
+                vProgress[part] = std::max(0, std::min(100, (int)(high * nParts * 100.0 / 65536.0 - part * 100.0 + 0.5)));
+                int nTotal = 0;
+                for (int i = 0; i < nParts; i++)
+                    nTotal += vProgress[i];
+                g_scan_progress = nTotal / nParts;
+            }
+            if (setScripts.count(coin.out.scriptPubKey))
+                vFound[part].push_back(std::make_pair(key, coin));
+            cursor.Next();
+        }
+        vProgress[part] = 100;
+        nSearched += count;
+        return true;
+    });
+
+    result.push_back(Pair("success", fOk));
+    if (!fOk && !g_should_abort_scan && !ShutdownRequested())
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Unable to read UTXO set");
+    result.push_back(Pair("searched_items", nSearched.load()));
+    result.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
+    result.push_back(Pair("height", pindex->nHeight));
+
+    CAmount nTotalIn = 0;
+    UniValue unspents(UniValue::VARR);
+    for (const std::vector<std::pair<COutPoint, Coin> >& vPart : vFound) {
+        for (const std::pair<COutPoint, Coin>& found : vPart) {
+            const COutPoint& outpoint = found.first;
+            const Coin& coin = found.second;
+            nTotalIn += coin.out.nValue;
+
+            UniValue unspent(UniValue::VOBJ);
+            unspent.push_back(Pair("txid", outpoint.hash.GetHex()));
+            unspent.push_back(Pair("vout", (int32_t)outpoint.n));
+            unspent.push_back(Pair("scriptPubKey", HexStr(coin.out.scriptPubKey.begin(), coin.out.scriptPubKey.end())));
+            unspent.push_back(Pair("amount", ValueFromAmount(coin.out.nValue)));
+            unspent.push_back(Pair("height", (int32_t)coin.nHeight));
+            unspents.push_back(unspent);
+        }
+    }
+    result.push_back(Pair("unspents", unspents));
+    result.push_back(Pair("total_amount", ValueFromAmount(nTotalIn)));
+    return result;
+}
+
 UniValue gettxout(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() < 2 || request.params.size() > 3)
@@ -928,7 +1357,6 @@ UniValue gettxout(const JSONRPCRequest& request)
             "        ,...\n"
             "     ]\n"
             "  },\n"
-            "  \"version\" : n,            (numeric) The version\n"
             "  \"coinbase\" : true|false   (boolean) Coinbase or not\n"
             "}\n"
 
@@ -952,33 +1380,33 @@ UniValue gettxout(const JSONRPCRequest& request)
     if (request.params.size() > 2)
         fMempool = request.params[2].get_bool();
 
-    CCoins coins;
+    if (n < 0)
+        return NullUniValue;
+    COutPoint out(hash, n);
+
+    Coin coin;
     if (fMempool) {
         LOCK(mempool.cs);
         CCoinsViewMemPool view(pcoinsTip, mempool);
-        if (!view.GetCoins(hash, coins))
+        if (!view.GetCoin(out, coin) || mempool.isSpent(out)) // TODO: filtering spent coins should be done by the CCoinsViewMemPool
             return NullUniValue;
-        mempool.pruneSpent(hash, coins); // TODO: this should be done by the CCoinsViewMemPool
     } else {
-        if (!pcoinsTip->GetCoins(hash, coins))
+        if (!pcoinsTip->GetCoin(out, coin))
             return NullUniValue;
     }
-    if (n<0 || (unsigned int)n>=coins.vout.size() || coins.vout[n].IsNull())
-        return NullUniValue;
 
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     CBlockIndex *pindex = it->second;
     ret.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
-    if ((unsigned int)coins.nHeight == MEMPOOL_HEIGHT)
+    if (coin.nHeight == MEMPOOL_HEIGHT)
         ret.push_back(Pair("confirmations", 0));
     else
-        ret.push_back(Pair("confirmations", pindex->nHeight - coins.nHeight + 1));
-    ret.push_back(Pair("value", ValueFromAmount(coins.vout[n].nValue)));
+        ret.push_back(Pair("confirmations", (int64_t)(pindex->nHeight - coin.nHeight + 1)));
+    ret.push_back(Pair("value", ValueFromAmount(coin.out.nValue)));
     UniValue o(UniValue::VOBJ);
-    ScriptPubKeyToJSON(coins.vout[n].scriptPubKey, o, true);
+    ScriptPubKeyToJSON(coin.out.scriptPubKey, o, true);
     ret.push_back(Pair("scriptPubKey", o));
-    ret.push_back(Pair("version", coins.nVersion));
-    ret.push_back(Pair("coinbase", coins.fCoinBase));
+    ret.push_back(Pair("coinbase", (bool)coin.fCoinBase));
 
     return ret;
 }
@@ -1432,7 +1860,11 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true,  {} },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true,  {"verbose"} },
     { "blockchain",         "gettxout",               &gettxout,               true,  {"txid","n","include_mempool"} },
-    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {} },
+    { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true,  {"hash_type"} },
+    { "blockchain",         "dumptxoutset",           &dumptxoutset,           true,  {"path"} },
+    { "blockchain",         "loadtxoutset",           &loadtxoutset,           true,  {"path","muhash"} },
+    { "blockchain",         "scantxoutset",           &scantxoutset,           true,  {"action","scanobjects"} },
+    { "blockchain",         "getdbinfo",              &getdbinfo,              true,  {} },
     { "blockchain",         "pruneblockchain",        &pruneblockchain,        true,  {"height"} },
     { "blockchain",         "verifychain",            &verifychain,            true,  {"checklevel","nblocks"} },
 
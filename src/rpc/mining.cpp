@@ -109,6 +109,10 @@ UniValue generateBlocks(boost::shared_ptr<CReserveScript> coinbaseScript, int nG
         nHeight = nHeightStart;
         nHeightEnd = nHeightStart+nGenerate;
     }
+    int nThreads = GetArg("-genproclimit", DEFAULT_GENERATE_THREADS);
+    if (nThreads <= 0)
+        nThreads = GetNumCores();
+    CNonceSearcher searcher(nThreads);
     unsigned int nExtraNonce = 0;
     UniValue blockHashes(UniValue::VARR);
     while (nHeight < nHeightEnd)
@@ -121,14 +125,17 @@ UniValue generateBlocks(boost::shared_ptr<CReserveScript> coinbaseScript, int nG
             LOCK(cs_main);
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
-        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetPoWHash(), pblock->nBits, Params().GetConsensus())) {
-            ++pblock->nNonce;
-            --nMaxTries;
-        }
-        if (nMaxTries == 0) {
+        const uint256 hashPrevBlock = pblock->hashPrevBlock;
+        std::function<bool()> fnTipChanged = [&hashPrevBlock]() {
+            LOCK(cs_main);
+            return chainActive.Tip()->GetBlockHash() != hashPrevBlock;
+        };
+        CNonceSearcher::Result result = searcher.Search(*pblock, nInnerLoopCount, nMaxTries, Params().GetConsensus(), fnTipChanged);
+        if (result == CNonceSearcher::MAX_TRIES) {
             break;
         }
-        if (pblock->nNonce == nInnerLoopCount) {
+        if (result != CNonceSearcher::FOUND) {
+            // Out of nonces for this extra nonce, or the template went stale.
             continue;
         }
         std::shared_ptr<const CBlock> shared_pblock = std::make_shared<const CBlock>(*pblock);
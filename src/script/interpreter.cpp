@@ -11,6 +11,7 @@
 #include "crypto/sha256.h"
 #include "pubkey.h"
 #include "script/script.h"
+#include "streams.h"
 #include "uint256.h"
 
 using namespace std;
@@ -56,11 +57,50 @@ bool CastToBool(const valtype& vch)
  */
 #define stacktop(i)  (stack.at(stack.size()+(i)))
 #define altstacktop(i)  (altstack.at(altstack.size()+(i)))
-static inline void popstack(vector<valtype>& stack)
+
+namespace {
+
+/**
+ * Recycles the buffers of stack elements over one script verification.
+ *
+ * Popped elements hand their buffer to the arena instead of freeing it, and
+ * pushes copy into a recycled buffer before falling back to the allocator, so
+ * once warm the stack machine runs without touching the heap. Only the
+ * capacity of the element vectors differs from plain push_back/pop_back; the
+ * stack contents, and therefore the consensus rules, do not.
+ */
+class StackArena
 {
-    if (stack.empty())
-        throw runtime_error("popstack(): stack empty");
-    stack.pop_back();
+private:
+    vector<valtype> spare;
+
+public:
+    void Pop(vector<valtype>& stack)
+    {
+        if (stack.empty())
+            throw runtime_error("popstack(): stack empty");
+        spare.push_back(std::move(stack.back()));
+        stack.pop_back();
+    }
+
+    /** Push a copy of vch, which may be an element of stack itself. */
+    void Push(vector<valtype>& stack, const valtype& vch)
+    {
+        valtype elem;
+        if (!spare.empty()) {
+            elem.swap(spare.back());
+            spare.pop_back();
+        }
+        elem.assign(vch.begin(), vch.end());
+        stack.push_back(std::move(elem));
+    }
+
+    void Push(vector<valtype>& stack, valtype&& vch)
+    {
+        stack.push_back(std::move(vch));
+    }
+};
+
 }
 
 bool static IsCompressedOrUncompressedPubKey(const valtype &vchPubKey) {
@@ -245,7 +285,7 @@ bool static CheckMinimalPush(const valtype& data, opcodetype opcode) {
     return true;
 }
 
-bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+static bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, StackArena& arena)
 {
     static const CScriptNum bnZero(0);
     static const CScriptNum bnOne(1);
@@ -307,7 +347,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                 if (fRequireMinimal && !CheckMinimalPush(vchPushValue, opcode)) {
                     return set_error(serror, SCRIPT_ERR_MINIMALDATA);
                 }
-                stack.push_back(vchPushValue);
+                arena.Push(stack, vchPushValue);
             } else if (fExec || (OP_IF <= opcode && opcode <= OP_ENDIF))
             switch (opcode)
             {
@@ -334,7 +374,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                 {
                     // ( -- value)
                     CScriptNum bn((int)opcode - (int)(OP_1 - 1));
-                    stack.push_back(bn.getvch());
+                    arena.Push(stack, bn.getvch());
                     // The result of these opcodes should always be the minimal way to push the data
                     // they push, so no need for a CheckMinimalPush here.
                 }
@@ -453,7 +493,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                         fValue = CastToBool(vch);
                         if (opcode == OP_NOTIF)
                             fValue = !fValue;
-                        popstack(stack);
+                        arena.Pop(stack);
                     }
                     vfExec.push_back(fValue);
                 }
@@ -483,7 +523,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     bool fValue = CastToBool(stacktop(-1));
                     if (fValue)
-                        popstack(stack);
+                        arena.Pop(stack);
                     else
                         return set_error(serror, SCRIPT_ERR_VERIFY);
                 }
@@ -503,8 +543,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                 {
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    altstack.push_back(stacktop(-1));
-                    popstack(stack);
+                    altstack.push_back(std::move(stacktop(-1)));
+                    stack.pop_back();
                 }
                 break;
 
@@ -512,8 +552,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                 {
                     if (altstack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_ALTSTACK_OPERATION);
-                    stack.push_back(altstacktop(-1));
-                    popstack(altstack);
+                    stack.push_back(std::move(altstacktop(-1)));
+                    altstack.pop_back();
                 }
                 break;
 
@@ -522,8 +562,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x1 x2 -- )
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    popstack(stack);
-                    popstack(stack);
+                    arena.Pop(stack);
+                    arena.Pop(stack);
                 }
                 break;
 
@@ -532,10 +572,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x1 x2 -- x1 x2 x1 x2)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-2);
-                    valtype vch2 = stacktop(-1);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    arena.Push(stack, stacktop(-2));
+                    arena.Push(stack, stacktop(-2));
                 }
                 break;
 
@@ -544,12 +582,9 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x1 x2 x3 -- x1 x2 x3 x1 x2 x3)
                     if (stack.size() < 3)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-3);
-                    valtype vch2 = stacktop(-2);
-                    valtype vch3 = stacktop(-1);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
-                    stack.push_back(vch3);
+                    arena.Push(stack, stacktop(-3));
+                    arena.Push(stack, stacktop(-3));
+                    arena.Push(stack, stacktop(-3));
                 }
                 break;
 
@@ -558,10 +593,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x1 x2 x3 x4 -- x1 x2 x3 x4 x1 x2)
                     if (stack.size() < 4)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-4);
-                    valtype vch2 = stacktop(-3);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    arena.Push(stack, stacktop(-4));
+                    arena.Push(stack, stacktop(-4));
                 }
                 break;
 
@@ -570,11 +603,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x1 x2 x3 x4 x5 x6 -- x3 x4 x5 x6 x1 x2)
                     if (stack.size() < 6)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch1 = stacktop(-6);
-                    valtype vch2 = stacktop(-5);
-                    stack.erase(stack.end()-6, stack.end()-4);
-                    stack.push_back(vch1);
-                    stack.push_back(vch2);
+                    std::rotate(stack.end()-6, stack.end()-4, stack.end());
                 }
                 break;
 
@@ -593,9 +622,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x - 0 | x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
-                    if (CastToBool(vch))
-                        stack.push_back(vch);
+                    if (CastToBool(stacktop(-1)))
+                        arena.Push(stack, stacktop(-1));
                 }
                 break;
 
@@ -603,7 +631,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                 {
                     // -- stacksize
                     CScriptNum bn(stack.size());
-                    stack.push_back(bn.getvch());
+                    arena.Push(stack, bn.getvch());
                 }
                 break;
 
@@ -612,7 +640,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x -- )
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    popstack(stack);
+                    arena.Pop(stack);
                 }
                 break;
 
@@ -621,8 +649,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x -- x x)
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
-                    stack.push_back(vch);
+                    arena.Push(stack, stacktop(-1));
                 }
                 break;
 
@@ -631,7 +658,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x1 x2 -- x2)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    stack.erase(stack.end() - 2);
+                    swap(stacktop(-2), stacktop(-1));
+                    arena.Pop(stack);
                 }
                 break;
 
@@ -640,8 +668,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x1 x2 -- x1 x2 x1)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-2);
-                    stack.push_back(vch);
+                    arena.Push(stack, stacktop(-2));
                 }
                 break;
 
@@ -653,13 +680,13 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     int n = CScriptNum(stacktop(-1), fRequireMinimal).getint();
-                    popstack(stack);
+                    arena.Pop(stack);
                     if (n < 0 || n >= (int)stack.size())
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-n-1);
                     if (opcode == OP_ROLL)
-                        stack.erase(stack.end()-n-1);
-                    stack.push_back(vch);
+                        std::rotate(stack.end()-n-1, stack.end()-n, stack.end());
+                    else
+                        arena.Push(stack, stacktop(-n-1));
                 }
                 break;
 
@@ -689,8 +716,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // (x1 x2 -- x2 x1 x2)
                     if (stack.size() < 2)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
-                    valtype vch = stacktop(-1);
-                    stack.insert(stack.end()-2, vch);
+                    arena.Push(stack, stacktop(-1));
+                    std::rotate(stack.end()-3, stack.end()-1, stack.end());
                 }
                 break;
 
@@ -701,7 +728,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     CScriptNum bn(stacktop(-1).size());
-                    stack.push_back(bn.getvch());
+                    arena.Push(stack, bn.getvch());
                 }
                 break;
 
@@ -724,13 +751,13 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     // zero bytes after it (numerically, 0x01 == 0x0001 == 0x000001)
                     //if (opcode == OP_NOTEQUAL)
                     //    fEqual = !fEqual;
-                    popstack(stack);
-                    popstack(stack);
-                    stack.push_back(fEqual ? vchTrue : vchFalse);
+                    arena.Pop(stack);
+                    arena.Pop(stack);
+                    arena.Push(stack, fEqual ? vchTrue : vchFalse);
                     if (opcode == OP_EQUALVERIFY)
                     {
                         if (fEqual)
-                            popstack(stack);
+                            arena.Pop(stack);
                         else
                             return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
                     }
@@ -762,8 +789,8 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     case OP_0NOTEQUAL:  bn = (bn != bnZero); break;
                     default:            assert(!"invalid opcode"); break;
                     }
-                    popstack(stack);
-                    stack.push_back(bn.getvch());
+                    arena.Pop(stack);
+                    arena.Push(stack, bn.getvch());
                 }
                 break;
 
@@ -810,14 +837,14 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     case OP_MAX:                 bn = (bn1 > bn2 ? bn1 : bn2); break;
                     default:                     assert(!"invalid opcode"); break;
                     }
-                    popstack(stack);
-                    popstack(stack);
-                    stack.push_back(bn.getvch());
+                    arena.Pop(stack);
+                    arena.Pop(stack);
+                    arena.Push(stack, bn.getvch());
 
                     if (opcode == OP_NUMEQUALVERIFY)
                     {
                         if (CastToBool(stacktop(-1)))
-                            popstack(stack);
+                            arena.Pop(stack);
                         else
                             return set_error(serror, SCRIPT_ERR_NUMEQUALVERIFY);
                     }
@@ -833,10 +860,10 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     CScriptNum bn2(stacktop(-2), fRequireMinimal);
                     CScriptNum bn3(stacktop(-1), fRequireMinimal);
                     bool fValue = (bn2 <= bn1 && bn1 < bn3);
-                    popstack(stack);
-                    popstack(stack);
-                    popstack(stack);
-                    stack.push_back(fValue ? vchTrue : vchFalse);
+                    arena.Pop(stack);
+                    arena.Pop(stack);
+                    arena.Pop(stack);
+                    arena.Push(stack, fValue ? vchTrue : vchFalse);
                 }
                 break;
 
@@ -854,19 +881,20 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     if (stack.size() < 1)
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     valtype& vch = stacktop(-1);
-                    valtype vchHash((opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32);
+                    unsigned char vchHash[32];
+                    size_t nHashSize = (opcode == OP_RIPEMD160 || opcode == OP_SHA1 || opcode == OP_HASH160) ? 20 : 32;
                     if (opcode == OP_RIPEMD160)
-                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CRIPEMD160().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA1)
-                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA1().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_SHA256)
-                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CSHA256().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_HASH160)
-                        CHash160().Write(vch.data(), vch.size()).Finalize(vchHash.data());
+                        CHash160().Write(vch.data(), vch.size()).Finalize(vchHash);
                     else if (opcode == OP_HASH256)
-                        CHash256().Write(vch.data(), vch.size()).Finalize(vchHash.data());
-                    popstack(stack);
-                    stack.push_back(vchHash);
+                        CHash256().Write(vch.data(), vch.size()).Finalize(vchHash);
+                    // Replace the input by its hash, reusing the element's buffer
+                    vch.assign(vchHash, vchHash + nHashSize);
                 }
                 break;                                   
 
@@ -904,13 +932,13 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                     if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
                         return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
 
-                    popstack(stack);
-                    popstack(stack);
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
+                    arena.Pop(stack);
+                    arena.Pop(stack);
+                    arena.Push(stack, fSuccess ? vchTrue : vchFalse);
                     if (opcode == OP_CHECKSIGVERIFY)
                     {
                         if (fSuccess)
-                            popstack(stack);
+                            arena.Pop(stack);
                         else
                             return set_error(serror, SCRIPT_ERR_CHECKSIGVERIFY);
                     }
@@ -998,7 +1026,7 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                             return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
                         if (ikey2 > 0)
                             ikey2--;
-                        popstack(stack);
+                        arena.Pop(stack);
                     }
 
                     // A bug causes CHECKMULTISIG to consume one extra argument
@@ -1011,14 +1039,14 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
                         return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
                     if ((flags & SCRIPT_VERIFY_NULLDUMMY) && stacktop(-1).size())
                         return set_error(serror, SCRIPT_ERR_SIG_NULLDUMMY);
-                    popstack(stack);
+                    arena.Pop(stack);
 
-                    stack.push_back(fSuccess ? vchTrue : vchFalse);
+                    arena.Push(stack, fSuccess ? vchTrue : vchFalse);
 
                     if (opcode == OP_CHECKMULTISIGVERIFY)
                     {
                         if (fSuccess)
-                            popstack(stack);
+                            arena.Pop(stack);
                         else
                             return set_error(serror, SCRIPT_ERR_CHECKMULTISIGVERIFY);
                     }
@@ -1045,6 +1073,12 @@ bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, un
     return set_success(serror);
 }
 
+bool EvalScript(vector<vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    StackArena arena;
+    return EvalScript(stack, script, flags, checker, sigversion, serror, arena);
+}
+
 namespace {
 
 /**
@@ -1173,6 +1207,37 @@ PrecomputedTransactionData::PrecomputedTransactionData(const CTransaction& txTo)
     hashPrevouts = GetPrevoutHash(txTo);
     hashSequence = GetSequenceHash(txTo);
     hashOutputs = GetOutputsHash(txTo);
+
+    // Inputs with a witness are signed with the BIP143 digest above; only
+    // the legacy midstates of transactions with other inputs are of use.
+    bool fLegacyInputs = false;
+    for (unsigned int n = 0; n < txTo.vin.size(); n++) {
+        if (txTo.vin[n].scriptWitness.IsNull()) {
+            fLegacyInputs = true;
+            break;
+        }
+    }
+    if (!fLegacyInputs || txTo.IsCoinBase())
+        return;
+
+    // Under legacy SIGHASH_ALL every input but the signed one is serialized
+    // as (prevout, empty script, nSequence), LEGACY_BLANK_INPUT_SIZE bytes
+    // each. Serialize them, the outputs and nLockTime once, and keep the
+    // hasher state in front of each input.
+    CVectorWriter writer(SER_GETHASH, 0, vLegacySuffix, 0);
+    for (unsigned int n = 0; n < txTo.vin.size(); n++) {
+        writer << txTo.vin[n].prevout << CScriptBase() << txTo.vin[n].nSequence;
+    }
+    writer << txTo.vout << txTo.nLockTime;
+
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << txTo.nVersion;
+    WriteCompactSize(ss, txTo.vin.size());
+    vLegacyMidstate.reserve(txTo.vin.size());
+    for (unsigned int n = 0; n < txTo.vin.size(); n++) {
+        vLegacyMidstate.push_back(ss);
+        ss.write((const char*)&vLegacySuffix[n * LEGACY_BLANK_INPUT_SIZE], LEGACY_BLANK_INPUT_SIZE);
+    }
 }
 
 uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsigned int nIn, int nHashType, const CAmount& amount, SigVersion sigversion, const PrecomputedTransactionData* cache)
@@ -1239,6 +1304,20 @@ uint256 SignatureHash(const CScript& scriptCode, const CTransaction& txTo, unsig
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer txTmp(txTo, scriptCode, nIn, nHashType);
 
+    if (cache && nIn < cache->vLegacyMidstate.size() && !(nHashType & SIGHASH_ANYONECANPAY) &&
+        (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        // Resume from the state after the inputs in front of nIn, serialize
+        // the signed input and append everything after it in one write.
+        CHashWriter ss(cache->vLegacyMidstate[nIn]);
+        ss << txTo.vin[nIn].prevout;
+        txTmp.SerializeScriptCode(ss);
+        ss << txTo.vin[nIn].nSequence;
+        size_t nSuffixPos = (nIn + 1) * PrecomputedTransactionData::LEGACY_BLANK_INPUT_SIZE;
+        ss.write((const char*)cache->vLegacySuffix.data() + nSuffixPos, cache->vLegacySuffix.size() - nSuffixPos);
+        ss << nHashType;
+        return ss.GetHash();
+    }
+
     // Serialize and hash
     CHashWriter ss(SER_GETHASH, 0);
     ss << txTmp << nHashType;
@@ -1353,7 +1432,38 @@ bool TransactionSignatureChecker::CheckSequence(const CScriptNum& nSequence) con
     return true;
 }
 
-static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+/**
+ * Evaluate "OP_DUP OP_HASH160 <pubKeyHash> OP_EQUALVERIFY OP_CHECKSIG" on a
+ * stack of (vchSig vchPubKey) without the generic interpreter. Checks happen
+ * in the same order, and fail with the same errors, as in EvalScript.
+ */
+static bool VerifyPubKeyHash(const valtype& vchSig, const valtype& vchPubKey, const valtype& pubKeyHash, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror)
+{
+    uint160 hash;
+    CHash160().Write(vchPubKey.data(), vchPubKey.size()).Finalize(hash.begin());
+    if (memcmp(hash.begin(), pubKeyHash.data(), 20))
+        return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+
+    CScript scriptCode;
+    scriptCode << OP_DUP << OP_HASH160 << pubKeyHash << OP_EQUALVERIFY << OP_CHECKSIG;
+    if (sigversion == SIGVERSION_BASE) {
+        scriptCode.FindAndDelete(CScript(vchSig));
+    }
+
+    if (!CheckSignatureEncoding(vchSig, flags, serror) || !CheckPubKeyEncoding(vchPubKey, flags, sigversion, serror)) {
+        //serror is set
+        return false;
+    }
+    bool fSuccess = checker.CheckSig(vchSig, vchPubKey, scriptCode, sigversion);
+
+    if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
+        return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
+    if (!fSuccess)
+        return set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+    return set_success(serror);
+}
+
+static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion, const std::vector<unsigned char>& program, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, StackArena& arena, bool fTemplates)
 {
     vector<vector<unsigned char> > stack;
     CScript scriptPubKey;
@@ -1376,6 +1486,11 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
             if (witness.stack.size() != 2) {
                 return set_error(serror, SCRIPT_ERR_WITNESS_PROGRAM_MISMATCH); // 2 items in witness
             }
+            if (fTemplates) {
+                if (witness.stack[0].size() > MAX_SCRIPT_ELEMENT_SIZE || witness.stack[1].size() > MAX_SCRIPT_ELEMENT_SIZE)
+                    return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
+                return VerifyPubKeyHash(witness.stack[0], witness.stack[1], program, flags, checker, SIGVERSION_WITNESS_V0, serror);
+            }
             scriptPubKey << OP_DUP << OP_HASH160 << program << OP_EQUALVERIFY << OP_CHECKSIG;
             stack = witness.stack;
         } else {
@@ -1394,7 +1509,7 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
             return set_error(serror, SCRIPT_ERR_PUSH_SIZE);
     }
 
-    if (!EvalScript(stack, scriptPubKey, flags, checker, SIGVERSION_WITNESS_V0, serror)) {
+    if (!EvalScript(stack, scriptPubKey, flags, checker, SIGVERSION_WITNESS_V0, serror, arena)) {
         return false;
     }
 
@@ -1406,7 +1521,79 @@ static bool VerifyWitnessProgram(const CScriptWitness& witness, int witversion,
     return true;
 }
 
-bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+/**
+ * Verify P2PKH, P2WPKH and P2SH-P2WPKH spends without the generic
+ * interpreter. Returns false if the scripts do not match one of these
+ * templates exactly, or use flags whose handling is left to the generic path;
+ * the caller must then run the full VerifyScript logic. Otherwise fResult and
+ * serror are set to what that logic would have produced.
+ */
+static bool VerifyScriptTemplate(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness& witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool& fResult)
+{
+    // Leave the flag combinations VerifyScript asserts against to it.
+    if ((flags & SCRIPT_VERIFY_WITNESS) && !(flags & SCRIPT_VERIFY_P2SH))
+        return false;
+    if ((flags & SCRIPT_VERIFY_CLEANSTACK) && !(flags & SCRIPT_VERIFY_WITNESS))
+        return false;
+
+    if (scriptPubKey.size() == 25 && scriptPubKey[0] == OP_DUP && scriptPubKey[1] == OP_HASH160 && scriptPubKey[2] == 20 &&
+        scriptPubKey[23] == OP_EQUALVERIFY && scriptPubKey[24] == OP_CHECKSIG) {
+        // P2PKH: the scriptSig must be two plain data pushes that EvalScript
+        // would accept; anything else takes the generic path.
+        valtype vchSig, vchPubKey;
+        opcodetype opcode;
+        CScript::const_iterator pc = scriptSig.begin();
+        if (!scriptSig.GetOp(pc, opcode, vchSig) || opcode > OP_PUSHDATA4 || vchSig.size() > MAX_SCRIPT_ELEMENT_SIZE)
+            return false;
+        if ((flags & SCRIPT_VERIFY_MINIMALDATA) && !CheckMinimalPush(vchSig, opcode))
+            return false;
+        if (!scriptSig.GetOp(pc, opcode, vchPubKey) || opcode > OP_PUSHDATA4 || vchPubKey.size() > MAX_SCRIPT_ELEMENT_SIZE)
+            return false;
+        if ((flags & SCRIPT_VERIFY_MINIMALDATA) && !CheckMinimalPush(vchPubKey, opcode))
+            return false;
+        if (pc != scriptSig.end())
+            return false;
+
+        fResult = VerifyPubKeyHash(vchSig, vchPubKey, valtype(scriptPubKey.begin() + 3, scriptPubKey.begin() + 23), flags, checker, SIGVERSION_BASE, serror);
+        if (fResult && (flags & SCRIPT_VERIFY_WITNESS) && !witness.IsNull())
+            fResult = set_error(serror, SCRIPT_ERR_WITNESS_UNEXPECTED);
+        return true;
+    }
+
+    if (!(flags & SCRIPT_VERIFY_WITNESS))
+        return false;
+
+    valtype program;
+    if (scriptPubKey.size() == 22 && scriptPubKey[0] == OP_0 && scriptPubKey[1] == 20) {
+        // P2WPKH: "OP_0 <program>" leaves the program on top of the stack.
+        if (scriptSig.size() != 0)
+            return false;
+        program.assign(scriptPubKey.begin() + 2, scriptPubKey.end());
+    } else if (scriptPubKey.IsPayToScriptHash() && scriptSig.size() == 23 && scriptSig[0] == 22 && scriptSig[1] == OP_0 && scriptSig[2] == 20) {
+        // P2SH-P2WPKH: the scriptSig is the single push of "OP_0 <program>"
+        // which VerifyScript demands for P2SH witness programs.
+        uint160 hash;
+        CHash160().Write(&scriptSig[1], 22).Finalize(hash.begin());
+        if (memcmp(hash.begin(), &scriptPubKey[2], 20)) {
+            fResult = set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+            return true;
+        }
+        program.assign(scriptSig.begin() + 3, scriptSig.end());
+    } else {
+        return false;
+    }
+
+    if (!CastToBool(program)) {
+        fResult = set_error(serror, SCRIPT_ERR_EVAL_FALSE);
+        return true;
+    }
+    StackArena arena;
+    fResult = VerifyWitnessProgram(witness, 0, program, flags, checker, serror, arena, true);
+    return true;
+}
+
+/** VerifyScript, checking the script templates directly if fTemplates is set. */
+static bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror, bool fTemplates)
 {
     static const CScriptWitness emptyWitness;
     if (witness == NULL) {
@@ -1420,13 +1607,21 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
         return set_error(serror, SCRIPT_ERR_SIG_PUSHONLY);
     }
 
+    bool fResult;
+    if (fTemplates && VerifyScriptTemplate(scriptSig, scriptPubKey, *witness, flags, checker, serror, fResult))
+        return fResult;
+
+    // One arena serves every evaluation below, so buffers freed by the
+    // scriptSig are reused by the scriptPubKey, redeemScript and witness.
+    StackArena arena;
     vector<vector<unsigned char> > stack, stackCopy;
-    if (!EvalScript(stack, scriptSig, flags, checker, SIGVERSION_BASE, serror))
+    if (!EvalScript(stack, scriptSig, flags, checker, SIGVERSION_BASE, serror, arena))
         // serror is set
         return false;
-    if (flags & SCRIPT_VERIFY_P2SH)
+    // The copy is only ever restored for P2SH, so skip it for other scripts
+    if ((flags & SCRIPT_VERIFY_P2SH) && scriptPubKey.IsPayToScriptHash())
         stackCopy = stack;
-    if (!EvalScript(stack, scriptPubKey, flags, checker, SIGVERSION_BASE, serror))
+    if (!EvalScript(stack, scriptPubKey, flags, checker, SIGVERSION_BASE, serror, arena))
         // serror is set
         return false;
     if (stack.empty())
@@ -1444,7 +1639,7 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
                 // The scriptSig must be _exactly_ CScript(), otherwise we reintroduce malleability.
                 return set_error(serror, SCRIPT_ERR_WITNESS_MALLEATED);
             }
-            if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror)) {
+            if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, arena, fTemplates)) {
                 return false;
             }
             // Bypass the cleanstack check at the end. The actual stack is obviously not clean
@@ -1470,9 +1665,9 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
 
         const valtype& pubKeySerialized = stack.back();
         CScript pubKey2(pubKeySerialized.begin(), pubKeySerialized.end());
-        popstack(stack);
+        arena.Pop(stack);
 
-        if (!EvalScript(stack, pubKey2, flags, checker, SIGVERSION_BASE, serror))
+        if (!EvalScript(stack, pubKey2, flags, checker, SIGVERSION_BASE, serror, arena))
             // serror is set
             return false;
         if (stack.empty())
@@ -1489,7 +1684,7 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
                     // reintroduce malleability.
                     return set_error(serror, SCRIPT_ERR_WITNESS_MALLEATED_P2SH);
                 }
-                if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror)) {
+                if (!VerifyWitnessProgram(*witness, witnessversion, witnessprogram, flags, checker, serror, arena, fTemplates)) {
                     return false;
                 }
                 // Bypass the cleanstack check at the end. The actual stack is obviously not clean
@@ -1525,6 +1720,16 @@ bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const C
     return set_success(serror);
 }
 
+bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    return VerifyScript(scriptSig, scriptPubKey, witness, flags, checker, serror, true);
+}
+
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror)
+{
+    return VerifyScript(scriptSig, scriptPubKey, witness, flags, checker, serror, false);
+}
+
 size_t static WitnessSigOps(int witversion, const std::vector<unsigned char>& witprogram, const CScriptWitness& witness, int flags)
 {
     if (witversion == 0) {
@@ -6,6 +6,7 @@
 #ifndef TCOIN_SCRIPT_INTERPRETER_H
 #define TCOIN_SCRIPT_INTERPRETER_H
 
+#include "hash.h"
 #include "script_error.h"
 #include "primitives/transaction.h"
 
@@ -114,6 +115,14 @@ struct PrecomputedTransactionData
 {
     uint256 hashPrevouts, hashSequence, hashOutputs;
 
+    /** Size of an input serialized as (prevout, empty script, nSequence) */
+    static const size_t LEGACY_BLANK_INPUT_SIZE = 36 + 1 + 4;
+    /** Legacy SIGHASH_ALL: every input blanked, then the outputs and nLockTime */
+    std::vector<unsigned char> vLegacySuffix;
+    /** Legacy SIGHASH_ALL: hasher state just before each input. Both are
+     *  left empty if every input has a witness. */
+    std::vector<CHashWriter> vLegacyMidstate;
+
     PrecomputedTransactionData(const CTransaction& tx);
 };
 
@@ -177,6 +186,13 @@ public:
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* error = NULL);
 bool VerifyScript(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = NULL);
 
+/**
+ * VerifyScript without its P2PKH, P2WPKH and P2SH-P2WPKH fast paths, running
+ * every script through EvalScript. It gives the same result and error as
+ * VerifyScript; tests use it to compare the two.
+ */
+bool VerifyScriptGeneric(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags, const BaseSignatureChecker& checker, ScriptError* serror = NULL);
+
 size_t CountWitnessSigOps(const CScript& scriptSig, const CScript& scriptPubKey, const CScriptWitness* witness, unsigned int flags);
 
 #endif // TCOIN_SCRIPT_INTERPRETER_H
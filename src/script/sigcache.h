@@ -7,7 +7,9 @@
 #define TCOIN_SCRIPT_SIGCACHE_H
 
 #include "script/interpreter.h"
+#include "uint256.h"
 
+#include <cstring>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MB (over 1000000 entries on 64-bit
@@ -19,6 +21,27 @@ static const int64_t MAX_MAX_SIG_CACHE_SIZE = 16384;
 
 class CPubKey;
 
+/**
+ * We're hashing a nonce into the entries themselves, so we don't need extra
+ * blinding in the set hash computation.
+ *
+ * This may exhibit platform endian dependent behavior but because these are
+ * nonced hashes (random) and this state is only ever used locally it is safe.
+ * All that matters is local consistency.
+ */
+class SignatureCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select <8, "SignatureCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin()+4*hash_select, 4);
+        return u;
+    }
+};
+
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
@@ -32,4 +55,14 @@ public:
 
 void InitSignatureCache();
 
+/** Copy out the signature cache nonce and the entries not yet marked for erasure. */
+void ExportSignatureCache(uint256& nonce, std::vector<uint256>& entries);
+
+/**
+ * Switch the signature cache to nonce and insert entries computed under it.
+ * Entries cached under the previous nonce no longer match, so this is only
+ * useful at startup, before any signature has been cached.
+ */
+void ImportSignatureCache(const uint256& nonce, const std::vector<uint256>& entries);
+
 #endif // TCOIN_SCRIPT_SIGCACHE_H
@@ -5,6 +5,7 @@
 
 #include "tcoinconsensus.h"
 
+#include "crypto/x17.h"
 #include "primitives/transaction.h"
 #include "pubkey.h"
 #include "script/interpreter.h"
@@ -68,6 +69,13 @@ struct ECCryptoClosure
 };
 
 ECCryptoClosure instance_of_eccryptoclosure;
+
+struct X17Closure
+{
+    X17Closure() { X17AutoDetect(); }
+};
+
+X17Closure instance_of_x17closure;
 }
 
 /** Check that all specified flags are part of the libconsensus interface. */
@@ -122,6 +130,12 @@ int tcoinconsensus_verify_script(const unsigned char *scriptPubKey, unsigned int
     return ::verify_script(scriptPubKey, scriptPubKeyLen, am, txTo, txToLen, nIn, flags, err);
 }
 
+void tcoinconsensus_x17_hash_headers(const unsigned char *prefix, const unsigned char *tails,
+                                     unsigned int nHeaders, unsigned char *hashes)
+{
+    CX17HeaderHasher(prefix).Hash(hashes, tails, nHeaders);
+}
+
 unsigned int tcoinconsensus_version()
 {
     // Just use the API version for now
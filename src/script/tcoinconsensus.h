@@ -33,7 +33,7 @@
 extern "C" {
 #endif
 
-#define TCOINCONSENSUS_API_VER 1
+#define TCOINCONSENSUS_API_VER 2
 
 typedef enum tcoinconsensus_error_t
 {
@@ -72,6 +72,15 @@ EXPORT_SYMBOL int tcoinconsensus_verify_script_with_amount(const unsigned char *
                                     const unsigned char *txTo        , unsigned int txToLen,
                                     unsigned int nIn, unsigned int flags, tcoinconsensus_error* err);
 
+/// Computes the X17 proof-of-work hashes of nHeaders serialized 80-byte block
+/// headers that all start with the 64 bytes pointed to by prefix, as when
+/// grinding nonces. tails points to the last 16 bytes of each header (the end
+/// of hashMerkleRoot, nTime, nBits and nNonce) back to back, and the 32-byte
+/// hashes are written back to back to hashes. The work that only depends on
+/// the prefix is done once per call.
+EXPORT_SYMBOL void tcoinconsensus_x17_hash_headers(const unsigned char *prefix, const unsigned char *tails,
+                                                   unsigned int nHeaders, unsigned char *hashes);
+
 EXPORT_SYMBOL unsigned int tcoinconsensus_version();
 
 #ifdef __cplusplus
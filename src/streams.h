@@ -138,6 +138,52 @@ private:
     size_t nPos;
 };
 
+/**
+ * XOR size bytes at data with key repeated, starting at key[key_offset].
+ *
+ * This runs over every value read from or written to an obfuscated
+ * database. Eight-byte keys, the size those use, are applied a word at a
+ * time; memcpy keeps that correct for data at any alignment, such as a
+ * stream's read position, and compiles to plain unaligned loads and stores.
+ */
+inline void XorData(unsigned char* data, size_t size, const std::vector<unsigned char>& key, size_t key_offset = 0)
+{
+    if (key.size() == 0) {
+        return;
+    }
+    key_offset %= key.size();
+
+    if (key.size() == 8) {
+        unsigned char key_rotated[8];
+        for (size_t j = 0; j < 8; j++)
+            key_rotated[j] = key[(key_offset + j) % 8];
+        uint64_t key_word;
+        memcpy(&key_word, key_rotated, 8);
+
+        size_t i = 0;
+        for (; i + 8 <= size; i += 8) {
+            uint64_t word;
+            memcpy(&word, data + i, 8);
+            word ^= key_word;
+            memcpy(data + i, &word, 8);
+        }
+        for (; i < size; i++)
+            data[i] ^= key_rotated[i % 8];
+        return;
+    }
+
+    for (size_t i = 0, j = key_offset; i != size; i++) {
+        data[i] ^= key[j++];
+
+        // This potentially acts on very many bytes of data, so it's
+        // important that we calculate `j`, i.e. the `key` index in this
+        // way instead of doing a %, which would effectively be a division
+        // for each byte Xor'd -- much slower than need be.
+        if (j == key.size())
+            j = 0;
+    }
+}
+
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
@@ -416,20 +462,10 @@ public:
      */
     void Xor(const std::vector<unsigned char>& key)
     {
-        if (key.size() == 0) {
+        if (size() == 0) {
             return;
         }
-
-        for (size_type i = 0, j = 0; i != size(); i++) {
-            vch[i] ^= key[j++];
-
-            // This potentially acts on very many bytes of data, so it's
-            // important that we calculate `j`, i.e. the `key` index in this
-            // way instead of doing a %, which would effectively be a division
-            // for each byte Xor'd -- much slower than need be.
-            if (j == key.size())
-                j = 0;
-        }
+        XorData((unsigned char*)data(), size(), key);
     }
 };
 
@@ -391,4 +391,34 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, uint256Hasher>>();
 }
 
+/* Test that for_each_live visits exactly the entries that are still
+ * contained and have not been marked for erasure, so that a cache rebuilt
+ * from them answers the same lookups.
+ */
+BOOST_AUTO_TEST_CASE(cuckoocache_for_each_live)
+{
+    insecure_rand = FastRandomContext(true);
+    CuckooCache::cache<uint256, uint256Hasher> cc{};
+    cc.setup_bytes(4 << 20);
+    std::vector<uint256> hashes(1000);
+    for (uint256& h : hashes) {
+        insecure_GetRandHash(h);
+        cc.insert(h);
+    }
+    // Mark the first half for erasure.
+    for (size_t i = 0; i < hashes.size() / 2; ++i)
+        BOOST_CHECK(cc.contains(hashes[i], true));
+
+    std::vector<uint256> live;
+    cc.for_each_live([&live](const uint256& h) { live.push_back(h); });
+    BOOST_CHECK_EQUAL(live.size(), hashes.size() - hashes.size() / 2);
+
+    CuckooCache::cache<uint256, uint256Hasher> rebuilt{};
+    rebuilt.setup_bytes(4 << 20);
+    for (const uint256& h : live)
+        rebuilt.insert(h);
+    for (size_t i = 0; i < hashes.size(); ++i)
+        BOOST_CHECK_EQUAL(rebuilt.contains(hashes[i], false), i >= hashes.size() / 2);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
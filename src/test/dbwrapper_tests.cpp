@@ -7,6 +7,9 @@
 #include "random.h"
 #include "test/test_tcoin.h"
 
+#include <set>
+#include <vector>
+
 #include <boost/assign/std/vector.hpp> // for 'operator+=()'
 #include <boost/assert.hpp>
 #include <boost/test/unit_test.hpp>
@@ -318,6 +321,91 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_parallel_scan)
+{
+    for (int i = 0; i < 2; i++) {
+        bool obfuscate = (bool)i;
+        boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        // Keys with the prefix 'k' are scanned, the neighbouring ones not.
+        std::set<uint256> keys;
+        for (int j = 0; j < 1000; j++) {
+            uint256 hash = GetRandHash();
+            keys.insert(hash);
+            BOOST_CHECK(dbw.Write(std::make_pair('k', hash), j));
+        }
+        BOOST_CHECK(dbw.Write('j', 1));
+        BOOST_CHECK(dbw.Write('l', 1));
+
+        CDBSnapshot snapshot(dbw);
+        // Not part of the snapshot.
+        BOOST_CHECK(dbw.Write(std::make_pair('k', GetRandHash()), 0));
+
+        std::vector<std::vector<uint256> > parts(4);
+        BOOST_CHECK(dbw.ParallelScan(snapshot, 'k', 'l', parts.size(), [&](int part, std::unique_ptr<CDBIterator> it) {
+            for (; it->Valid(); it->Next()) {
+                std::pair<char, uint256> key;
+                if (!it->GetKey(key) || key.first != 'k')
+                    return false;
+                parts[part].push_back(key.second);
+            }
+            return true;
+        }));
+
+        // Every key was seen once, and in order across the parts.
+        std::vector<uint256> seen;
+        for (const std::vector<uint256>& part : parts) {
+            // Random keys are split evenly enough for no part to be empty.
+            BOOST_CHECK(!part.empty());
+            seen.insert(seen.end(), part.begin(), part.end());
+        }
+        BOOST_CHECK(seen == std::vector<uint256>(keys.begin(), keys.end()));
+
+        // Failures of a part are reported.
+        BOOST_CHECK(!dbw.ParallelScan(snapshot, 'k', 'l', 4, [](int part, std::unique_ptr<CDBIterator> it) {
+            return part != 2;
+        }));
+    }
+}
 
+BOOST_AUTO_TEST_CASE(dbwrapper_options)
+{
+    CDBOptions dbopts;
+    BOOST_CHECK_EQUAL(dbopts.nBloomBits, DEFAULT_DB_BLOOM_BITS);
+    BOOST_CHECK(dbopts.Set("bloombits", "0"));
+    BOOST_CHECK(dbopts.Set("blocksize", "65536"));
+    BOOST_CHECK(dbopts.Set("maxopenfiles", "1000"));
+    BOOST_CHECK(dbopts.Set("compression", "1"));
+    BOOST_CHECK(!dbopts.Set("bloombits", "-1"));
+    BOOST_CHECK(!dbopts.Set("bloombits", "ten"));
+    BOOST_CHECK(!dbopts.Set("blocksize", "512"));
+    BOOST_CHECK(!dbopts.Set("maxopenfiles", "10"));
+    BOOST_CHECK(!dbopts.Set("compression", "yes"));
+    BOOST_CHECK(!dbopts.Set("cachesize", "1"));
+    BOOST_CHECK_EQUAL(dbopts.nBloomBits, 0);
+    BOOST_CHECK_EQUAL(dbopts.nBlockSize, 65536U);
+    BOOST_CHECK_EQUAL(dbopts.nMaxOpenFiles, 1000);
+    BOOST_CHECK(dbopts.fCompression);
+
+    // Both without and with a bloom filter, present and missing keys are
+    // found as before.
+    for (int bits = 0; bits <= 20; bits += 10) {
+        dbopts.nBloomBits = bits;
+        boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+        CDBWrapper dbw(ph, (1 << 20), true, false, true, dbopts);
+        BOOST_CHECK_EQUAL(dbw.GetDBOptions().nBloomBits, bits);
+        BOOST_CHECK_EQUAL(dbw.GetDBOptions().nBlockSize, 65536U);
+
+        for (uint32_t i = 0; i < 1000; i += 2)
+            BOOST_CHECK(dbw.Write(i, i));
+        dbw.CompactRange((uint32_t)0, (uint32_t)1000);
+        for (uint32_t i = 0; i < 1000; i++) {
+            uint32_t res;
+            BOOST_CHECK_EQUAL(dbw.Exists(i), i % 2 == 0);
+            BOOST_CHECK_EQUAL(dbw.Read(i, res), i % 2 == 0);
+        }
+    }
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,9 +3,17 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "crypto/common.h"
+#include "crypto/x17.h"
+#include "primitives/block.h"
 #include "utilstrencodings.h"
+#include "test/test_random.h"
 #include "test/test_tcoin.h"
 
+#if defined(HAVE_CONSENSUS_LIB)
+#include "script/tcoinconsensus.h"
+#endif
+
 #include <vector>
 
 #include <boost/test/unit_test.hpp>
@@ -105,6 +113,13 @@ BOOST_AUTO_TEST_CASE(siphash)
 
     BOOST_CHECK_EQUAL(SipHashUint256(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, uint256S("1f1e1d1c1b1a191817161514131211100f0e0d0c0b0a09080706050403020100")), 0x7127512f72f27cceull);
 
+    // SipHashUint256Extra equals hashing the 32 bytes followed by the little-endian extra word
+    uint256 val = uint256S("1f1e1d1c1b1a191817161514131211100f0e0d0c0b0a09080706050403020100");
+    const unsigned char extra[4] = {0x78, 0x56, 0x34, 0x12};
+    CSipHasher hasher4(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
+    hasher4.Write(val.begin(), 32).Write(extra, 4);
+    BOOST_CHECK_EQUAL(SipHashUint256Extra(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, val, 0x12345678), hasher4.Finalize());
+
     // Check test vectors from spec, one byte at a time
     CSipHasher hasher2(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL);
     for (uint8_t x=0; x<ARRAYLEN(siphash_4_2_testvec); ++x)
@@ -130,4 +145,124 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+BOOST_AUTO_TEST_CASE(x17_batch)
+{
+    // The batched hashes must match GetPoWHash for every batch size,
+    // including the partial groups at the end of a batch.
+    for (int n = 0; n <= 9; n++) {
+        std::vector<CBlockHeader> headers(n);
+        for (CBlockHeader& header : headers) {
+            header.nVersion = insecure_rand();
+            header.hashPrevBlock = GetRandHash();
+            header.hashMerkleRoot = GetRandHash();
+            header.nTime = insecure_rand();
+            header.nBits = insecure_rand();
+            header.nNonce = insecure_rand();
+        }
+        std::vector<uint256> hashes = GetPoWHashes(headers);
+        BOOST_CHECK_EQUAL(hashes.size(), (size_t)n);
+        for (int i = 0; i < n; i++) {
+            BOOST_CHECK_EQUAL(hashes[i].ToString(), headers[i].GetPoWHash().ToString());
+        }
+    }
+}
+
+template<typename Ctx, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+static void SphHash64(unsigned char* out, const unsigned char* in)
+{
+    Ctx ctx;
+    Init(&ctx);
+    Update(&ctx, in, 64);
+    Close(&ctx, out);
+}
+
+BOOST_AUTO_TEST_CASE(x17_aes_stages)
+{
+    // The selected (possibly AES-NI) Groestl, SHAvite and ECHO stages must
+    // agree with the sph reference code.
+    for (int i = 0; i < 32; i++) {
+        uint512 in, out, expected;
+        for (int j = 0; j < 16; j++) WriteLE32(in.begin() + 4 * j, insecure_rand());
+
+        X17Groestl512_64(out.begin(), in.begin());
+        SphHash64<sph_groestl512_context, sph_groestl512_init, sph_groestl512, sph_groestl512_close>(expected.begin(), in.begin());
+        BOOST_CHECK(out == expected);
+
+        X17Shavite512_64(out.begin(), in.begin());
+        SphHash64<sph_shavite512_context, sph_shavite512_init, sph_shavite512, sph_shavite512_close>(expected.begin(), in.begin());
+        BOOST_CHECK(out == expected);
+
+        X17Echo512_64(out.begin(), in.begin());
+        SphHash64<sph_echo512_context, sph_echo512_init, sph_echo512, sph_echo512_close>(expected.begin(), in.begin());
+        BOOST_CHECK(out == expected);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(x17_lane_stages)
+{
+    // The selected (possibly AVX2 4-way) stages must agree with the sph
+    // reference code in every lane.
+    typedef void (*SphFn)(unsigned char* out, const unsigned char* in);
+    static const struct {
+        X17LaneStage stage;
+        SphFn sph;
+        size_t size;
+    } stages[] = {
+        {X17_BMW512, SphHash64<sph_bmw512_context, sph_bmw512_init, sph_bmw512, sph_bmw512_close>, 64},
+        {X17_SKEIN512, SphHash64<sph_skein512_context, sph_skein512_init, sph_skein512, sph_skein512_close>, 64},
+        {X17_JH512, SphHash64<sph_jh512_context, sph_jh512_init, sph_jh512, sph_jh512_close>, 64},
+        {X17_KECCAK512, SphHash64<sph_keccak512_context, sph_keccak512_init, sph_keccak512, sph_keccak512_close>, 64},
+        {X17_LUFFA512, SphHash64<sph_luffa512_context, sph_luffa512_init, sph_luffa512, sph_luffa512_close>, 64},
+        {X17_CUBEHASH512, SphHash64<sph_cubehash512_context, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close>, 64},
+        {X17_HAMSI512, SphHash64<sph_hamsi512_context, sph_hamsi512_init, sph_hamsi512, sph_hamsi512_close>, 64},
+        {X17_SHABAL512, SphHash64<sph_shabal512_context, sph_shabal512_init, sph_shabal512, sph_shabal512_close>, 64},
+        {X17_SHA512, SphHash64<sph_sha512_context, sph_sha512_init, sph_sha512, sph_sha512_close>, 64},
+        {X17_HAVAL256_5, SphHash64<sph_haval256_5_context, sph_haval256_5_init, sph_haval256_5, sph_haval256_5_close>, 32},
+    };
+    for (int i = 0; i < 8; i++) {
+        unsigned char in[4 * 64], out[4 * 64], expected[64];
+        for (int j = 0; j < 64; j++) WriteLE32(in + 4 * j, insecure_rand());
+        for (const auto& s : stages) {
+            X17HashStage4(s.stage, out, in);
+            for (int lane = 0; lane < 4; lane++) {
+                s.sph(expected, in + 64 * lane);
+                BOOST_CHECK(memcmp(out + 64 * lane, expected, s.size) == 0);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(x17_midstate)
+{
+    // Headers that share their first 64 bytes, hashed through a single
+    // CX17HeaderHasher, must match GetPoWHash one by one.
+    CBlockHeader header;
+    header.nVersion = insecure_rand();
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    const unsigned char* prefix = (const unsigned char*)BEGIN(header.nVersion);
+    CX17HeaderHasher hasher(prefix);
+
+    for (size_t n = 0; n < 10; n++) {
+        std::vector<CBlockHeader> headers(n, header);
+        std::vector<unsigned char> tails(n * CX17HeaderHasher::TAIL_SIZE);
+        for (size_t i = 0; i < n; i++) {
+            headers[i].nTime = insecure_rand();
+            headers[i].nBits = insecure_rand();
+            headers[i].nNonce = insecure_rand();
+            memcpy(&tails[i * CX17HeaderHasher::TAIL_SIZE], BEGIN(headers[i].nVersion) + CX17HeaderHasher::PREFIX_SIZE, CX17HeaderHasher::TAIL_SIZE);
+        }
+        std::vector<uint256> hashes(n);
+        hasher.Hash(hashes.empty() ? nullptr : hashes[0].begin(), tails.data(), n);
+        for (size_t i = 0; i < n; i++) {
+            BOOST_CHECK_EQUAL(hashes[i].ToString(), headers[i].GetPoWHash().ToString());
+        }
+#if defined(HAVE_CONSENSUS_LIB)
+        std::vector<uint256> libhashes(n);
+        tcoinconsensus_x17_hash_headers(prefix, tails.data(), n, libhashes.empty() ? nullptr : libhashes[0].begin());
+        BOOST_CHECK(libhashes == hashes);
+#endif
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -133,4 +133,30 @@ BOOST_AUTO_TEST_CASE(merkle_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(merkle_test_BlockWitness)
+{
+    // The batched witness merkle root must agree with the root implied by
+    // the (separately computed) merkle branches of its leaves.
+    for (int ntx = 1; ntx <= 33; ntx++) {
+        CBlock block;
+        block.vtx.resize(ntx);
+        std::vector<uint256> leaves(ntx);
+        for (int j = 0; j < ntx; j++) {
+            CMutableTransaction mtx;
+            mtx.nLockTime = j;
+            mtx.vin.resize(1);
+            mtx.vin[0].scriptWitness.stack.push_back(std::vector<unsigned char>(1, j));
+            block.vtx[j] = MakeTransactionRef(std::move(mtx));
+            if (j > 0) leaves[j] = block.vtx[j]->GetWitnessHash();
+        }
+        bool mutated = true;
+        uint256 root = BlockWitnessMerkleRoot(block, &mutated);
+        BOOST_CHECK(!mutated);
+        BOOST_CHECK(root == ComputeMerkleRoot(leaves));
+        for (int j = 0; j < ntx; j++) {
+            BOOST_CHECK(ComputeMerkleRootFromBranch(leaves[j], ComputeMerkleBranch(leaves, j), j) == root);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -10,6 +10,7 @@
 #include "validation.h"
 #include "miner.h"
 #include "policy/policy.h"
+#include "pow.h"
 #include "pubkey.h"
 #include "script/standard.h"
 #include "txmempool.h"
@@ -493,4 +494,57 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+BOOST_AUTO_TEST_CASE(nonce_searcher)
+{
+    const Consensus::Params& params = Params(CBaseChainParams::REGTEST).GetConsensus();
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.hashPrevBlock = GetRandHash();
+    header.hashMerkleRoot = GetRandHash();
+    header.nTime = 1234567890;
+    header.nBits = 0x2000ffff; // about one hash in 256 is valid
+
+    // The lowest valid nonce, found serially.
+    uint32_t nFirst = 0;
+    for (header.nNonce = 0; header.nNonce < 0x10000; header.nNonce++) {
+        if (CheckProofOfWork(header.GetPoWHash(), header.nBits, params))
+            break;
+    }
+    BOOST_REQUIRE(header.nNonce < 0x10000);
+    nFirst = header.nNonce;
+
+    std::function<bool()> fnNever = []() { return false; };
+    std::function<bool()> fnAlways = []() { return true; };
+    for (int nThreads : {1, 3}) {
+        CNonceSearcher searcher(nThreads);
+        CBlockHeader h = header;
+        uint64_t nTries = 1000000;
+
+        h.nNonce = 0;
+        BOOST_CHECK_EQUAL(searcher.Search(h, 0x10000, nTries, params, fnNever), CNonceSearcher::FOUND);
+        BOOST_CHECK(CheckProofOfWork(h.GetPoWHash(), h.nBits, params));
+        if (nThreads == 1) {
+            BOOST_CHECK_EQUAL(h.nNonce, nFirst);
+            BOOST_CHECK_EQUAL(nTries, 1000000U - nFirst);
+        }
+
+        // Every nonce below nFirst is tried, and none is valid.
+        h.nNonce = 0;
+        nTries = 1000000;
+        BOOST_CHECK_EQUAL(searcher.Search(h, nFirst, nTries, params, fnNever), CNonceSearcher::EXHAUSTED);
+        BOOST_CHECK_EQUAL(nTries, 1000000U - nFirst);
+
+        if (nFirst > 0) {
+            h.nNonce = 0;
+            nTries = nFirst;
+            BOOST_CHECK_EQUAL(searcher.Search(h, 0x10000, nTries, params, fnNever), CNonceSearcher::MAX_TRIES);
+            BOOST_CHECK_EQUAL(nTries, 0U);
+        }
+
+        h.nNonce = 0;
+        nTries = 1000000;
+        BOOST_CHECK_EQUAL(searcher.Search(h, 0x10000, nTries, params, fnAlways), CNonceSearcher::ABORTED);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
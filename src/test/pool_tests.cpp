@@ -0,0 +1,179 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "coins.h"
+#include "memusage.h"
+#include "support/allocators/pool.h"
+
+#include "test/test_tcoin.h"
+#include "test/test_random.h"
+
+#include <cstring>
+#include <unordered_map>
+#include <vector>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    PoolResource<8, 8> resource;
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // first chunk is already allocated, the first allocation is carved out of it
+    void* block = resource.Allocate(8, 8);
+    BOOST_CHECK(block != nullptr);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // a deallocated block is handed out again by the next allocation of that size
+    resource.Deallocate(block, 8, 8);
+    BOOST_CHECK(resource.Allocate(8, 8) == block);
+
+    // 0 bytes are rounded up to one element
+    void* b = resource.Allocate(0, 1);
+    BOOST_CHECK(b != nullptr && b != block);
+    resource.Deallocate(b, 0, 1);
+    BOOST_CHECK(resource.Allocate(1, 1) == b);
+
+    // too large or too strictly aligned blocks are served by operator new
+    void* big = resource.Allocate(16, 8);
+    resource.Deallocate(big, 16, 8);
+    void* aligned = resource.Allocate(8, 16);
+    resource.Deallocate(aligned, 8, 16);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+}
+
+BOOST_AUTO_TEST_CASE(chunk_allocation)
+{
+    // chunk size is rounded up to the alignment
+    PoolResource<16, 8> resource(30);
+    BOOST_CHECK_EQUAL(resource.ChunkSizeBytes(), 32U);
+
+    std::vector<void*> blocks;
+    for (int i = 0; i < 4; ++i) {
+        blocks.push_back(resource.Allocate(8, 8));
+    }
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+
+    // the fifth block needs a new chunk
+    blocks.push_back(resource.Allocate(8, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+
+    // 24 bytes are left in the second chunk, enough for one 16 byte block
+    blocks.push_back(resource.Allocate(16, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    blocks.push_back(resource.Allocate(16, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 3U);
+
+    // the 8 leftover bytes of the second chunk went to the freelist
+    void* leftover = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 3U);
+    BOOST_CHECK(static_cast<unsigned char*>(leftover) == static_cast<unsigned char*>(blocks[5]) + 16);
+}
+
+BOOST_AUTO_TEST_CASE(random_allocations)
+{
+    struct PtrSizeAlignment {
+        void* ptr;
+        size_t bytes;
+        size_t alignment;
+        unsigned char fill;
+    };
+
+    // makes a bunch of random allocations and gives all of them back in random order.
+    PoolResource<128, 8> resource(65536);
+    std::vector<PtrSizeAlignment> ptr_size_alignment;
+    for (size_t i = 0; i < 1000; ++i) {
+        // make it a bit more likely to allocate than deallocate
+        if (ptr_size_alignment.empty() || 0 != insecure_rand() % 4) {
+            // allocate a random item
+            size_t alignment = size_t(1) << (insecure_rand() % 5); // 1, 2, ..., 16
+            size_t bytes = (insecure_rand() % 160) / alignment * alignment; // 0, ..., 159, multiple of alignment
+            void* ptr = resource.Allocate(bytes, alignment);
+            BOOST_CHECK_EQUAL(reinterpret_cast<uintptr_t>(ptr) % alignment, 0U);
+            unsigned char fill = insecure_rand();
+            memset(ptr, fill, bytes);
+            ptr_size_alignment.push_back({ptr, bytes, alignment, fill});
+        } else {
+            // deallocate a random item, after checking nobody else wrote over it
+            size_t idx = insecure_rand() % ptr_size_alignment.size();
+            PtrSizeAlignment& x = ptr_size_alignment[idx];
+            for (size_t j = 0; j < x.bytes; ++j) {
+                BOOST_CHECK_EQUAL(static_cast<unsigned char*>(x.ptr)[j], x.fill);
+            }
+            resource.Deallocate(x.ptr, x.bytes, x.alignment);
+            std::swap(x, ptr_size_alignment.back());
+            ptr_size_alignment.pop_back();
+        }
+    }
+
+    // deallocate all the rest
+    for (const PtrSizeAlignment& x : ptr_size_alignment) {
+        resource.Deallocate(x.ptr, x.bytes, x.alignment);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(memusage_test)
+{
+    typedef std::unordered_map<int, int, std::hash<int>, std::equal_to<int>,
+                               PoolAllocator<std::pair<const int, int>, sizeof(std::pair<const int, int>) + sizeof(void*) * 4> >
+        Map;
+    Map::allocator_type::ResourceType resource(1024);
+
+    {
+        Map map(0, std::hash<int>(), std::equal_to<int>(), &resource);
+        size_t prev_usage = memusage::DynamicUsage(map);
+        for (int i = 0; i < 1000; ++i) {
+            map[i];
+            size_t usage = memusage::DynamicUsage(map);
+            // the usage can only grow while inserting, one chunk at a time or with the bucket array
+            BOOST_CHECK(usage >= prev_usage);
+            prev_usage = usage;
+        }
+        BOOST_CHECK_EQUAL(map.size(), 1000U);
+        BOOST_CHECK(resource.NumAllocatedChunks() > 1);
+
+        // the nodes are kept in the pool for reuse, so erasing and
+        // reinserting does not need any more chunks
+        size_t chunks = resource.NumAllocatedChunks();
+        for (int i = 0; i < 1000; ++i) {
+            map.erase(i);
+        }
+        for (int i = 1000; i < 2000; ++i) {
+            map[i];
+        }
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), chunks);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_flush_releases_memory)
+{
+    CCoinsView base;
+    CCoinsViewCache cache(&base);
+    size_t empty_usage = cache.DynamicMemoryUsage();
+
+    for (uint32_t i = 0; i < 50000; ++i) {
+        Coin coin;
+        coin.out.nValue = i + 1;
+        coin.nHeight = 1;
+        cache.AddCoin(COutPoint(uint256(), i), std::move(coin), false);
+    }
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 50000U);
+    BOOST_CHECK(cache.DynamicMemoryUsage() > empty_usage);
+
+    // CCoinsView::BatchWrite does not consume the entries, but Flush must
+    // still leave an empty cache that is back at its initial usage.
+    cache.Flush();
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), empty_usage);
+
+    // and the cache is usable again afterwards
+    Coin coin;
+    coin.out.nValue = 1;
+    cache.AddCoin(COutPoint(uint256(), 0), std::move(coin), false);
+    BOOST_CHECK(cache.HaveCoinInCache(COutPoint(uint256(), 0)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,9 +4,11 @@
 
 #include "chain.h"
 #include "chainparams.h"
+#include "consensus/validation.h"
 #include "pow.h"
 #include "random.h"
 #include "util.h"
+#include "validation.h"
 #include "test/test_tcoin.h"
 
 #include <boost/test/unit_test.hpp>
@@ -93,4 +95,53 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+struct RegtestingSetup : public TestingSetup {
+    RegtestingSetup() : TestingSetup(CBaseChainParams::REGTEST) {}
+};
+
+/* A header batch with bad proof of work in the middle must be rejected as if
+ * its headers were checked one by one: the ones before it accepted, the bad
+ * one and the rest not, with the same reject reason and DoS score. */
+BOOST_FIXTURE_TEST_CASE(headers_bad_pow_in_batch, RegtestingSetup)
+{
+    const CChainParams& chainparams = Params();
+    const Consensus::Params& params = chainparams.GetConsensus();
+    const size_t nHeaders = 40, nBad = 20;
+
+    std::vector<CBlockHeader> headers;
+    uint256 hashPrev = chainActive.Tip()->GetBlockHash();
+    uint32_t nTime = chainActive.Tip()->GetBlockTime();
+    for (size_t i = 0; i < nHeaders; i++) {
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.hashPrevBlock = hashPrev;
+        header.hashMerkleRoot = GetRandHash();
+        header.nTime = ++nTime;
+        header.nBits = GetNextWorkRequired(chainActive.Tip(), &header, params);
+        while (CheckProofOfWork(header.GetPoWHash(), header.nBits, params) != (i != nBad)) {
+            ++header.nNonce;
+        }
+        headers.push_back(header);
+        hashPrev = header.GetHash();
+    }
+
+    CValidationState stateBatch;
+    BOOST_CHECK(!ProcessNewBlockHeaders(headers, stateBatch, chainparams));
+    for (size_t i = 0; i < nHeaders; i++) {
+        BOOST_CHECK_EQUAL(mapBlockIndex.count(headers[i].GetHash()), i < nBad ? 1U : 0U);
+    }
+
+    // Only the bad header is new now, so this goes through the serial check.
+    CValidationState stateSerial;
+    BOOST_CHECK(!ProcessNewBlockHeaders(std::vector<CBlockHeader>(1, headers[nBad]), stateSerial, chainparams));
+
+    int nDoSBatch = 0, nDoSSerial = 0;
+    BOOST_CHECK(stateBatch.IsInvalid(nDoSBatch));
+    BOOST_CHECK(stateSerial.IsInvalid(nDoSSerial));
+    BOOST_CHECK_EQUAL(nDoSBatch, nDoSSerial);
+    BOOST_CHECK_EQUAL(nDoSBatch, 50);
+    BOOST_CHECK_EQUAL(stateBatch.GetRejectReason(), stateSerial.GetRejectReason());
+    BOOST_CHECK_EQUAL(stateBatch.GetRejectReason(), "high-hash");
+}
+
 BOOST_AUTO_TEST_SUITE_END()
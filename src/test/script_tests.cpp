@@ -13,6 +13,7 @@
 #include "util.h"
 #include "utilstrencodings.h"
 #include "test/test_tcoin.h"
+#include "test/test_random.h"
 #include "rpc/server.h"
 
 #if defined(HAVE_CONSENSUS_LIB)
@@ -167,6 +168,8 @@ void DoTest(const CScript& scriptPubKey, const CScript& scriptSig, const CScript
     CMutableTransaction tx2 = tx;
     BOOST_CHECK_MESSAGE(VerifyScript(scriptSig, scriptPubKey, &scriptWitness, flags, MutableTransactionSignatureChecker(&tx, 0, txCredit.vout[0].nValue), &err) == expect, message);
     BOOST_CHECK_MESSAGE(err == scriptError, std::string(FormatScriptError(err)) + " where " + std::string(FormatScriptError((ScriptError_t)scriptError)) + " expected: " + message);
+    BOOST_CHECK_MESSAGE(VerifyScriptGeneric(scriptSig, scriptPubKey, &scriptWitness, flags, MutableTransactionSignatureChecker(&tx, 0, txCredit.vout[0].nValue), &err) == expect, "generic path: " + message);
+    BOOST_CHECK_MESSAGE(err == scriptError, std::string(FormatScriptError(err)) + " where " + std::string(FormatScriptError((ScriptError_t)scriptError)) + " expected on generic path: " + message);
 #if defined(HAVE_CONSENSUS_LIB)
     CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
     stream << tx2;
@@ -1443,4 +1446,122 @@ BOOST_AUTO_TEST_CASE(script_FindAndDelete)
     BOOST_CHECK(s == expect);
 }
 
+static void MutateScriptData(std::vector<unsigned char>& vch)
+{
+    switch (insecure_rand() % 4) {
+    case 0:
+        if (!vch.empty())
+            vch[insecure_rand() % vch.size()] ^= 1 << (insecure_rand() % 8);
+        break;
+    case 1:
+        if (!vch.empty())
+            vch.resize(insecure_rand() % vch.size());
+        break;
+    case 2:
+        vch.push_back(insecure_rand() % 256);
+        break;
+    case 3:
+        vch.clear();
+        break;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(script_template_fastpaths)
+{
+    // Spend P2PKH, P2WPKH and P2SH-P2WPKH outputs with valid and randomly
+    // damaged scriptSigs, witnesses and scriptPubKeys under random flags, and
+    // check that the template fast paths in VerifyScript agree with the
+    // generic interpreter on both the result and the error.
+    static const unsigned int vFlags[] = {
+        SCRIPT_VERIFY_STRICTENC, SCRIPT_VERIFY_DERSIG, SCRIPT_VERIFY_LOW_S, SCRIPT_VERIFY_SIGPUSHONLY,
+        SCRIPT_VERIFY_MINIMALDATA, SCRIPT_VERIFY_NULLFAIL, SCRIPT_VERIFY_WITNESS_PUBKEYTYPE,
+        SCRIPT_VERIFY_P2SH, SCRIPT_VERIFY_WITNESS, SCRIPT_VERIFY_CLEANSTACK,
+    };
+    const CAmount amount = 12345;
+
+    for (int i = 0; i < 600; i++) {
+        CKey key;
+        key.MakeNewKey(insecure_rand() % 4 != 0);
+        CPubKey pubkey = key.GetPubKey();
+        CScript scriptP2PKH = GetScriptForDestination(pubkey.GetID());
+        CScript scriptP2WPKH = CScript() << OP_0 << ToByteVector(pubkey.GetID());
+
+        int nTemplate = i % 3;
+        CScript scriptPubKey;
+        if (nTemplate == 0) {
+            scriptPubKey = scriptP2PKH;
+        } else if (nTemplate == 1) {
+            scriptPubKey = scriptP2WPKH;
+        } else {
+            scriptPubKey = GetScriptForDestination(CScriptID(scriptP2WPKH));
+        }
+
+        CMutableTransaction txCredit = BuildCreditingTransaction(scriptPubKey, amount);
+        CMutableTransaction txSpend = BuildSpendingTransaction(CScript(), CScriptWitness(), txCredit);
+        SigVersion sigversion = nTemplate == 0 ? SIGVERSION_BASE : SIGVERSION_WITNESS_V0;
+        uint256 hash = SignatureHash(scriptP2PKH, txSpend, 0, SIGHASH_ALL, amount, sigversion);
+        std::vector<unsigned char> vchSig;
+        BOOST_CHECK(key.Sign(hash, vchSig));
+        vchSig.push_back((unsigned char)SIGHASH_ALL);
+        std::vector<unsigned char> vchPubKey = ToByteVector(pubkey);
+        std::vector<unsigned char> vchRedeem = ToByteVector(scriptP2WPKH);
+
+        int nMutate = insecure_rand() % 6;
+        if (nMutate == 1) MutateScriptData(vchSig);
+        if (nMutate == 2) MutateScriptData(vchPubKey);
+        if (nMutate == 3) MutateScriptData(vchRedeem);
+
+        CScript scriptSig;
+        CScriptWitness witness;
+        if (nTemplate == 0) {
+            scriptSig << vchSig << vchPubKey;
+        } else {
+            witness.stack.push_back(vchSig);
+            witness.stack.push_back(vchPubKey);
+            if (nTemplate == 2)
+                scriptSig << vchRedeem;
+        }
+        if (nMutate == 4) {
+            std::vector<unsigned char> vch(scriptSig.begin(), scriptSig.end());
+            MutateScriptData(vch);
+            scriptSig = CScript(vch.begin(), vch.end());
+        }
+        if (nMutate == 5) {
+            std::vector<unsigned char> vch(scriptPubKey.begin(), scriptPubKey.end());
+            MutateScriptData(vch);
+            scriptPubKey = CScript(vch.begin(), vch.end());
+        }
+        bool fWitnessMutated = insecure_rand() % 8 == 0;
+        if (fWitnessMutated) {
+            if (witness.stack.empty() || insecure_rand() % 2)
+                witness.stack.push_back(std::vector<unsigned char>(insecure_rand() % 3));
+            else
+                witness.stack.pop_back();
+        }
+        txSpend.vin[0].scriptSig = scriptSig;
+        txSpend.vin[0].scriptWitness = witness;
+
+        unsigned int flags = 0;
+        for (unsigned int f : vFlags) {
+            if (insecure_rand() % 2)
+                flags |= f;
+        }
+        if (flags & SCRIPT_VERIFY_CLEANSTACK)
+            flags |= SCRIPT_VERIFY_WITNESS;
+        if (flags & SCRIPT_VERIFY_WITNESS)
+            flags |= SCRIPT_VERIFY_P2SH;
+
+        MutableTransactionSignatureChecker checker(&txSpend, 0, amount);
+        ScriptError errFast, errGeneric;
+        bool fFast = VerifyScript(scriptSig, scriptPubKey, &witness, flags, checker, &errFast);
+        bool fGeneric = VerifyScriptGeneric(scriptSig, scriptPubKey, &witness, flags, checker, &errGeneric);
+
+        BOOST_CHECK_EQUAL(fFast, fGeneric);
+        BOOST_CHECK_MESSAGE(errFast == errGeneric, std::string(FormatScriptError(errFast)) + " where " + FormatScriptError(errGeneric) + " expected, template " + std::to_string(nTemplate) + ", flags " + FormatScriptFlags(flags));
+        bool fWitnessChecked = nTemplate != 0 && (flags & SCRIPT_VERIFY_WITNESS);
+        if (nMutate == 0 && !fWitnessMutated && !(fWitnessChecked && (flags & SCRIPT_VERIFY_WITNESS_PUBKEYTYPE) && !pubkey.IsCompressed()))
+            BOOST_CHECK(fFast);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
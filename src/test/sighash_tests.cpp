@@ -160,6 +160,21 @@ BOOST_AUTO_TEST_CASE(sighash_test)
         std::cout << "\n";
         #endif
         BOOST_CHECK(sh == sho);
+
+        // The precomputed legacy midstates must give the same hash
+        CTransaction tx(txTo);
+        PrecomputedTransactionData txdata(tx);
+        BOOST_CHECK(SignatureHash(scriptCode, tx, nIn, nHashType, 0, SIGVERSION_BASE, &txdata) == sho);
+
+        // They are not built if every input has a witness, which leaves the
+        // hash unchanged too
+        CMutableTransaction txWitness(txTo);
+        for (unsigned int n = 0; n < txWitness.vin.size(); n++)
+            txWitness.vin[n].scriptWitness.stack.push_back(std::vector<unsigned char>(1));
+        CTransaction txw(txWitness);
+        PrecomputedTransactionData txdataWitness(txw);
+        BOOST_CHECK(txdataWitness.vLegacyMidstate.empty());
+        BOOST_CHECK(SignatureHash(scriptCode, txw, nIn, nHashType, 0, SIGVERSION_BASE, &txdataWitness) == sho);
     }
     #if defined(PRINT_SIGHASH_JSON)
     std::cout << "]\n";
@@ -211,6 +226,10 @@ BOOST_AUTO_TEST_CASE(sighash_from_data)
 
         sh = SignatureHash(scriptCode, *tx, nIn, nHashType, 0, SIGVERSION_BASE);
         BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
+
+        PrecomputedTransactionData txdata(*tx);
+        sh = SignatureHash(scriptCode, *tx, nIn, nHashType, 0, SIGVERSION_BASE, &txdata);
+        BOOST_CHECK_MESSAGE(sh.GetHex() == sigHashHex, strTest);
     }
 }
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include "streams.h"
 #include "support/allocators/zeroafterfree.h"
 #include "test/test_tcoin.h"
+#include "test/test_random.h"
 
 #include <boost/assign/std/vector.hpp> // for 'operator+=()'
 #include <boost/assert.hpp>
@@ -121,4 +122,39 @@ BOOST_AUTO_TEST_CASE(streams_serializedata_xor)
             std::string(ds.begin(), ds.end()));  
 }         
 
+BOOST_AUTO_TEST_CASE(streams_serializedata_xor_wordwise)
+{
+    // Compare against XORing byte by byte, for every key size around the
+    // eight bytes that take the word-wise path, at every key offset and at
+    // unaligned read positions.
+    std::vector<unsigned char> data(67);
+    for (unsigned int i = 0; i < data.size(); i++)
+        data[i] = insecure_rand();
+
+    for (unsigned int key_size = 1; key_size <= 9; key_size++) {
+        std::vector<unsigned char> key(key_size);
+        for (unsigned int i = 0; i < key_size; i++)
+            key[i] = insecure_rand();
+
+        for (unsigned int offset = 0; offset < 2 * key_size; offset++) {
+            for (unsigned int size = 0; size < data.size(); size++) {
+                std::vector<unsigned char> expected(data.begin(), data.begin() + size);
+                for (unsigned int i = 0; i < size; i++)
+                    expected[i] ^= key[(offset + i) % key_size];
+                std::vector<unsigned char> out(data.begin(), data.begin() + size);
+                XorData(out.data(), out.size(), key, offset);
+                BOOST_CHECK(out == expected);
+            }
+        }
+
+        for (unsigned int skip = 0; skip < 9; skip++) {
+            CDataStream ds(data, 0, 0);
+            ds.ignore(skip);
+            ds.Xor(key);
+            for (unsigned int i = 0; i < ds.size(); i++)
+                BOOST_CHECK_EQUAL(ds[i], (char)(data[skip + i] ^ key[i % key_size]));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
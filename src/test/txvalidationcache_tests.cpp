@@ -84,4 +84,67 @@ BOOST_FIXTURE_TEST_CASE(tx_mempool_block_doublespend, TestChain100Setup)
     BOOST_CHECK_EQUAL(mempool.size(), 0);
 }
 
+BOOST_FIXTURE_TEST_CASE(checkinputs_script_execution_cache, TestingSetup)
+{
+    // A transaction whose scripts all passed with cacheFullScriptStore set
+    // should skip script checks on the next CheckInputs with the same flags,
+    // and only with the same flags.
+
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptPubKey = CScript() <<  ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+
+    CMutableTransaction funding;
+    funding.nVersion = 1;
+    funding.vin.resize(1);
+    funding.vin[0].prevout.hash = GetRandHash();
+    funding.vin[0].prevout.n = 0;
+    funding.vout.resize(1);
+    funding.vout[0].nValue = 11*CENT;
+    funding.vout[0].scriptPubKey = scriptPubKey;
+
+    CMutableTransaction spend;
+    spend.nVersion = 1;
+    spend.vin.resize(1);
+    spend.vin[0].prevout.hash = funding.GetHash();
+    spend.vin[0].prevout.n = 0;
+    spend.vout.resize(1);
+    spend.vout[0].nValue = 10*CENT;
+    spend.vout[0].scriptPubKey = scriptPubKey;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, spend, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    spend.vin[0].scriptSig << vchSig;
+
+    LOCK(cs_main);
+
+    CCoinsViewCache view(pcoinsTip);
+    AddCoins(view, funding, 1);
+
+    const CTransaction tx(spend);
+    PrecomputedTransactionData txdata(tx);
+    CValidationState state;
+    const unsigned int flags = SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_DERSIG;
+
+    // Deferred checks are never cached, since they have not run yet.
+    std::vector<CScriptCheck> vChecks;
+    BOOST_CHECK(CheckInputs(tx, state, view, true, flags, true, true, txdata, &vChecks));
+    BOOST_CHECK_EQUAL(vChecks.size(), 1U);
+    vChecks.clear();
+    BOOST_CHECK(CheckInputs(tx, state, view, true, flags, true, true, txdata, &vChecks));
+    BOOST_CHECK_EQUAL(vChecks.size(), 1U);
+    vChecks.clear();
+
+    // Inline execution with cacheFullScriptStore records the transaction...
+    BOOST_CHECK(CheckInputs(tx, state, view, true, flags, true, true, txdata));
+    BOOST_CHECK(CheckInputs(tx, state, view, true, flags, false, false, txdata, &vChecks));
+    BOOST_CHECK(vChecks.empty());
+
+    // ...under its script flags only.
+    BOOST_CHECK(CheckInputs(tx, state, view, true, flags | SCRIPT_VERIFY_LOW_S, false, false, txdata, &vChecks));
+    BOOST_CHECK_EQUAL(vChecks.size(), 1U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,151 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainparams.h"
+#include "coins.h"
+#include "consensus/validation.h"
+#include "streams.h"
+#include "txdb.h"
+#include "utxosnapshot.h"
+#include "validation.h"
+
+#include "test/test_tcoin.h"
+#include "test/test_random.h"
+
+#include <map>
+
+#include <boost/filesystem.hpp>
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(utxosnapshot_tests, TestingSetup)
+
+//! Add a header-only block on top of the genesis block, like one received during headers sync.
+static CBlockIndex* AddHeader()
+{
+    LOCK(cs_main);
+    CBlockHeader header;
+    header.hashPrevBlock = chainActive.Genesis()->GetBlockHash();
+    header.nTime = chainActive.Genesis()->nTime + 600;
+    header.nBits = chainActive.Genesis()->nBits;
+    CBlockIndex* pindex = new CBlockIndex(header);
+    BlockMap::iterator it = mapBlockIndex.insert(std::make_pair(header.GetHash(), pindex)).first;
+    pindex->phashBlock = &it->first;
+    pindex->pprev = chainActive.Genesis();
+    pindex->nHeight = 1;
+    pindex->nChainWork = pindex->pprev->nChainWork + GetBlockProof(*pindex);
+    pindex->BuildSkip();
+    pindex->RaiseValidity(BLOCK_VALID_TREE);
+    return pindex;
+}
+
+static void WriteSnapshot(const boost::filesystem::path& path, CCoinsViewDB& view, const CUTXOSnapshotMetadata& metadata, uint64_t& nCoins, uint256& hashUTXOSet)
+{
+    std::unique_ptr<CDBSnapshot> psnapshot(view.NewSnapshot());
+    CAutoFile fileout(fopen(path.string().c_str(), "wb"), SER_DISK, CLIENT_VERSION);
+    BOOST_REQUIRE(!fileout.IsNull());
+    BOOST_REQUIRE(DumpUTXOSnapshot(fileout, view, *psnapshot, 4, metadata, nCoins, hashUTXOSet));
+}
+
+BOOST_AUTO_TEST_CASE(utxosnapshot_roundtrip)
+{
+    CBlockIndex* pindexBase = AddHeader();
+
+    // Chainstate of another node at pindexBase.
+    CCoinsViewDB source(1 << 20, true);
+    std::map<COutPoint, Coin> coins;
+    {
+        CCoinsViewCache cache(&source);
+        // Up to three outputs per transaction, which the dump must keep
+        // together even though it reads the coins in several parts.
+        uint256 txid;
+        for (int i = 0; i < 1000; i++) {
+            if (i % 3 == 0 || insecure_rand() % 4 == 0)
+                txid = GetRandHash();
+            COutPoint outpoint(txid, i % 3 * 2 + insecure_rand() % 2);
+            Coin coin;
+            coin.out.nValue = insecure_rand() + 1;
+            coin.out.scriptPubKey.assign(insecure_rand() % 40, 0);
+            coin.nHeight = insecure_rand() % 2;
+            coin.fCoinBase = insecure_rand() % 2;
+            coins[outpoint] = coin;
+            cache.AddCoin(outpoint, std::move(coin), false);
+        }
+        cache.SetBestBlock(pindexBase->GetBlockHash());
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    boost::filesystem::path path = pathTemp / "utxo.dat";
+    CUTXOSnapshotMetadata metadata(Params().MessageStart(), pindexBase->GetBlockHash(), 3);
+    uint64_t nCoins;
+    uint256 hashUTXOSet;
+    WriteSnapshot(path, source, metadata, nCoins, hashUTXOSet);
+    BOOST_CHECK_EQUAL(nCoins, coins.size());
+    CCoinsCommitment commitment;
+    for (std::map<COutPoint, Coin>::const_iterator it = coins.begin(); it != coins.end(); ++it) {
+        commitment.Add(it->first, it->second);
+    }
+    BOOST_CHECK(hashUTXOSet == commitment.GetHash());
+
+    // A corrupted copy is rejected without touching the chainstate.
+    boost::filesystem::path pathCorrupt = pathTemp / "corrupt.dat";
+    boost::filesystem::copy_file(path, pathCorrupt);
+    {
+        FILE* file = fopen(pathCorrupt.string().c_str(), "r+b");
+        BOOST_REQUIRE(file != NULL);
+        fseek(file, 200, SEEK_SET);
+        int ch = fgetc(file);
+        fseek(file, 200, SEEK_SET);
+        fputc(ch ^ 1, file);
+        fclose(file);
+    }
+    CValidationState state;
+    uint64_t nLoaded = 0;
+    BOOST_CHECK(!LoadUTXOSnapshot(state, Params(), pathCorrupt, hashUTXOSet, nLoaded));
+    BOOST_CHECK(pindexSnapshotBase == NULL);
+    BOOST_CHECK(chainActive.Tip() == chainActive.Genesis());
+    BOOST_CHECK(pcoinsTip->GetBestBlock() == chainActive.Genesis()->GetBlockHash());
+
+    // So is a snapshot of another network.
+    boost::filesystem::path pathOther = pathTemp / "other.dat";
+    CUTXOSnapshotMetadata metadataOther(Params(CBaseChainParams::TESTNET).MessageStart(), pindexBase->GetBlockHash(), 3);
+    uint256 hashOther;
+    WriteSnapshot(pathOther, source, metadataOther, nCoins, hashOther);
+    state = CValidationState();
+    BOOST_CHECK(!LoadUTXOSnapshot(state, Params(), pathOther, hashOther, nLoaded));
+    BOOST_CHECK(pindexSnapshotBase == NULL);
+
+    // So is an intact snapshot of a UTXO set other than the expected one.
+    state = CValidationState();
+    BOOST_CHECK(!LoadUTXOSnapshot(state, Params(), path, GetRandHash(), nLoaded));
+    BOOST_CHECK(pindexSnapshotBase == NULL);
+    BOOST_CHECK(pcoinsTip->GetBestBlock() == chainActive.Genesis()->GetBlockHash());
+    BOOST_CHECK(!pcoinsTip->HaveCoin(coins.begin()->first));
+
+    state = CValidationState();
+    BOOST_REQUIRE(LoadUTXOSnapshot(state, Params(), path, hashUTXOSet, nLoaded));
+    BOOST_CHECK_EQUAL(nLoaded, coins.size());
+    BOOST_CHECK(pindexSnapshotBase == pindexBase);
+    BOOST_CHECK(chainActive.Tip() == pindexBase);
+    BOOST_CHECK_EQUAL(pindexBase->nChainTx, 3U);
+    BOOST_CHECK(pcoinsTip->GetBestBlock() == pindexBase->GetBlockHash());
+    for (std::map<COutPoint, Coin>::const_iterator it = coins.begin(); it != coins.end(); ++it) {
+        const Coin& coin = pcoinsTip->AccessCoin(it->first);
+        BOOST_CHECK(coin.out == it->second.out);
+        BOOST_CHECK_EQUAL(coin.nHeight, it->second.nHeight);
+        BOOST_CHECK_EQUAL(coin.fCoinBase, it->second.fCoinBase);
+    }
+
+    // The base is recorded for the next start.
+    uint256 hashBlock;
+    unsigned int nChainTx;
+    BOOST_CHECK(pblocktree->ReadUTXOSnapshot(hashBlock, nChainTx));
+    BOOST_CHECK(hashBlock == pindexBase->GetBlockHash());
+    BOOST_CHECK_EQUAL(nChainTx, 3U);
+
+    // Only an empty chainstate can be loaded into.
+    state = CValidationState();
+    BOOST_CHECK(!LoadUTXOSnapshot(state, Params(), path, hashUTXOSet, nLoaded));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
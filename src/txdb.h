@@ -29,6 +29,8 @@ static constexpr int MAX_BLOCK_COINSDB_USAGE = 200 * DB_PEAK_USAGE_FACTOR;
 static constexpr int MIN_BLOCK_COINSDB_USAGE = 50 * DB_PEAK_USAGE_FACTOR;
 //! -dbcache default (MiB)
 static const int64_t nDefaultDbCache = 450;
+//! -dbbatchsize default (bytes)
+static const int64_t nDefaultDbBatchSize = 16 << 20;
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -42,6 +44,11 @@ static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
 
+//! Coins database key of the block the UTXO set is consistent with
+static const char DB_BEST_BLOCK = 'B';
+//! Coins database key of the new and old tips, present while a flush is in progress
+static const char DB_HEAD_BLOCKS = 'H';
+
 struct CDiskTxPos : public CDiskBlockPos
 {
     unsigned int nTxOffset; // after header
@@ -73,13 +80,32 @@ class CCoinsViewDB : public CCoinsView
 protected:
     CDBWrapper db;
 public:
-    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CCoinsViewDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbopts = CDBOptions());
 
-    bool GetCoins(const uint256 &txid, CCoins &coins) const;
-    bool HaveCoins(const uint256 &txid) const;
+    bool GetCoin(const COutPoint &outpoint, Coin &coin) const;
+    bool HaveCoin(const COutPoint &outpoint) const;
     uint256 GetBestBlock() const;
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock);
+    std::vector<uint256> GetHeadBlocks() const;
+    bool GetCommitment(CCoinsCommitment &commitment) const;
+    const CDBOptions& GetDBOptions() const { return db.GetDBOptions(); }
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, const CCoinsCommitment &delta, bool erase = true);
     CCoinsViewCursor *Cursor() const;
+
+    //! Attempt to update from an older database format. Returns false if an error occurred or the upgrade was interrupted.
+    bool Upgrade();
+
+    //! Compute the commitment from all coins if the database has none, e.g. after a replay. Returns false if that failed or was interrupted.
+    bool RebuildCommitment();
+
+    //! Take a snapshot of the database for ParallelScan.
+    CDBSnapshot *NewSnapshot() const;
+
+    //! Iterate over all coins in snapshot with up to nParts cursors, each
+    //! over its own range of txids and on its own thread. Only coins whose
+    //! txid starts with a byte in [nFirstByte, nLastByte] are visited.
+    //! See CDBWrapper::ParallelScan.
+    bool ParallelScan(const CDBSnapshot& snapshot, int nParts, const std::function<bool(int, CCoinsViewCursor&)>& fn,
+                      unsigned char nFirstByte = 0x00, unsigned char nLastByte = 0xff) const;
 };
 
 /** Specialization of CCoinsViewCursor to iterate over a CCoinsViewDB */
@@ -88,8 +114,8 @@ class CCoinsViewDBCursor: public CCoinsViewCursor
 public:
     ~CCoinsViewDBCursor() {}
 
-    bool GetKey(uint256 &key) const;
-    bool GetValue(CCoins &coins) const;
+    bool GetKey(COutPoint &key) const;
+    bool GetValue(Coin &coin) const;
     unsigned int GetValueSize() const;
 
     bool Valid() const;
@@ -99,7 +125,10 @@ private:
     CCoinsViewDBCursor(CDBIterator* pcursorIn, const uint256 &hashBlockIn):
         CCoinsViewCursor(hashBlockIn), pcursor(pcursorIn) {}
     std::unique_ptr<CDBIterator> pcursor;
-    std::pair<char, uint256> keyTmp;
+    std::pair<char, COutPoint> keyTmp;
+
+    //! Cache the key of the record the iterator is at.
+    void ReadKey();
 
     friend class CCoinsViewDB;
 };
@@ -108,7 +137,7 @@ private:
 class CBlockTreeDB : public CDBWrapper
 {
 public:
-    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, const CDBOptions& dbopts = CDBOptions());
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
@@ -122,6 +151,10 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    //! Base block and its nChainTx of a chainstate loaded from a UTXO snapshot
+    bool WriteUTXOSnapshot(const uint256 &hashBlock, unsigned int nChainTx);
+    bool ReadUTXOSnapshot(uint256 &hashBlock, unsigned int &nChainTx);
+    bool EraseUTXOSnapshot();
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
 };
 
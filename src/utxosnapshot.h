@@ -0,0 +1,78 @@
+// Copyright (c) 2017 The Tcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef TCOIN_UTXOSNAPSHOT_H
+#define TCOIN_UTXOSNAPSHOT_H
+
+#include "protocol.h"
+#include "serialize.h"
+#include "uint256.h"
+
+#include <string.h>
+
+static const unsigned char UTXO_SNAPSHOT_MAGIC[5] = {'u', 't', 'x', 'o', 0xff};
+static const uint16_t UTXO_SNAPSHOT_VERSION = 1;
+
+/**
+ * Header of a UTXO snapshot file, as written by dumptxoutset.
+ *
+ * It is followed by the unspent outputs grouped by txid: the txid, the number
+ * of outputs, then the output index and the Coin for each of them. A null txid
+ * ends the list, after which come the total number of coins and the double
+ * SHA256 of everything that precedes it, header included.
+ */
+class CUTXOSnapshotMetadata
+{
+public:
+    unsigned char pchMagic[5];
+    uint16_t nVersion;
+    CMessageHeader::MessageStartChars pchMessageStart;
+    //! Block the chainstate was at when it was dumped
+    uint256 hashBlock;
+    //! nChainTx of that block, which a loading node cannot compute itself
+    unsigned int nChainTx;
+
+    CUTXOSnapshotMetadata()
+    {
+        SetNull();
+    }
+
+    CUTXOSnapshotMetadata(const CMessageHeader::MessageStartChars& pchMessageStartIn, const uint256& hashBlockIn, unsigned int nChainTxIn)
+    {
+        memcpy(pchMagic, UTXO_SNAPSHOT_MAGIC, sizeof(pchMagic));
+        nVersion = UTXO_SNAPSHOT_VERSION;
+        memcpy(pchMessageStart, pchMessageStartIn, sizeof(pchMessageStart));
+        hashBlock = hashBlockIn;
+        nChainTx = nChainTxIn;
+    }
+
+    void SetNull()
+    {
+        memset(pchMagic, 0, sizeof(pchMagic));
+        nVersion = 0;
+        memset(pchMessageStart, 0, sizeof(pchMessageStart));
+        hashBlock.SetNull();
+        nChainTx = 0;
+    }
+
+    bool IsValid(const CMessageHeader::MessageStartChars& pchMessageStartIn) const
+    {
+        return memcmp(pchMagic, UTXO_SNAPSHOT_MAGIC, sizeof(pchMagic)) == 0 &&
+               nVersion == UTXO_SNAPSHOT_VERSION &&
+               memcmp(pchMessageStart, pchMessageStartIn, sizeof(pchMessageStart)) == 0;
+    }
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(FLATDATA(pchMagic));
+        READWRITE(nVersion);
+        READWRITE(FLATDATA(pchMessageStart));
+        READWRITE(hashBlock);
+        READWRITE(nChainTx);
+    }
+};
+
+#endif // TCOIN_UTXOSNAPSHOT_H
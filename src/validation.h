@@ -32,14 +32,18 @@
 #include <boost/unordered_map.hpp>
 #include <boost/filesystem/path.hpp>
 
+class CAutoFile;
 class CBlockIndex;
 class CBlockTreeDB;
+class CCoinsViewDB;
 class CBloomFilter;
 class CChainParams;
 class CInv;
 class CConnman;
+class CDBSnapshot;
 class CScriptCheck;
 class CTxMemPool;
+class CUTXOSnapshotMetadata;
 class CValidationInterface;
 class CValidationState;
 struct ChainTxData;
@@ -186,6 +190,9 @@ extern uint256 hashAssumeValid;
 /** Best header we've seen so far (used for getheaders queries' starting points). */
 extern CBlockIndex *pindexBestHeader;
 
+/** Base block of the UTXO snapshot the chainstate was loaded from, if any. There is no block data below it. */
+extern CBlockIndex *pindexSnapshotBase;
+
 /** Minimum disk space required - used in CheckDiskSpace() */
 static const uint64_t nMinDiskSpace = 52428800;
 
@@ -259,10 +266,16 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
 bool InitBlockIndex(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk */
 bool LoadBlockIndex(const CChainParams& chainparams);
+/** Update the chain tip based on database information. */
+bool LoadChainTip(const CChainParams& chainparams);
 /** Unload database information */
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the block input prefetching thread */
+void ThreadCoinsPrefetch();
+/** Run an instance of the header proof-of-work checking thread */
+void ThreadPoWCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -313,6 +326,8 @@ void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 CBlockIndex * InsertBlockIndex(uint256 hash);
 /** Flush all state, indexes and buffers to disk. */
 void FlushStateToDisk();
+/** Write all state, indexes and buffers to disk, but keep the coins cache. */
+void SyncStateToDisk();
 /** Prune block files and flush state to disk. */
 void PruneAndFlush();
 /** Prune block files up to a given height */
@@ -363,13 +378,17 @@ unsigned int GetP2SHSigOpCount(const CTransaction& tx, const CCoinsViewCache& ma
  */
 int64_t GetTransactionSigOpCost(const CTransaction& tx, const CCoinsViewCache& inputs, int flags);
 
+/** Initializes the script-execution cache */
+void InitScriptExecutionCache();
+
 /**
  * Check whether all inputs of this transaction are valid (no double spends, scripts & sigs, amounts)
  * This does not modify the UTXO set. If pvChecks is not NULL, script checks are pushed onto it
- * instead of being performed inline.
+ * instead of being performed inline. If cacheFullScriptStore is set and all scripts were
+ * executed inline, the transaction is recorded in the script execution cache under (wtxid, flags).
  */
 bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsViewCache &view, bool fScriptChecks,
-                 unsigned int flags, bool cacheStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = NULL);
+                 unsigned int flags, bool cacheSigStore, bool cacheFullScriptStore, PrecomputedTransactionData& txdata, std::vector<CScriptCheck> *pvChecks = NULL);
 
 /** Apply the effects of this transaction on the UTXO set represented by view */
 void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, int nHeight);
@@ -447,8 +466,8 @@ private:
 
 public:
     CScriptCheck(): amount(0), ptxTo(0), nIn(0), nFlags(0), cacheStore(false), error(SCRIPT_ERR_UNKNOWN_ERROR) {}
-    CScriptCheck(const CCoins& txFromIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
-        scriptPubKey(txFromIn.vout[txToIn.vin[nInIn].prevout.n].scriptPubKey), amount(txFromIn.vout[txToIn.vin[nInIn].prevout.n].nValue),
+    CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
+        scriptPubKey(outIn.scriptPubKey), amount(outIn.nValue),
         ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) { }
 
     bool operator()();
@@ -467,6 +486,54 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing the proof-of-work check of a run of block headers.
+ * The headers are hashed together through the batched X17 engine.
+ */
+class CPoWCheck
+{
+private:
+    std::vector<CBlockHeader> headers;
+    const Consensus::Params *pparams;
+
+public:
+    CPoWCheck(): pparams(NULL) {}
+    CPoWCheck(std::vector<CBlockHeader>&& headersIn, const Consensus::Params& params) :
+        headers(std::move(headersIn)), pparams(&params) { }
+
+    bool operator()();
+
+    void swap(CPoWCheck &check) {
+        headers.swap(check.headers);
+        std::swap(pparams, check.pparams);
+    }
+};
+
+/**
+ * Closure reading a single block input from the coins database, so that the
+ * reads of all inputs of a block can be spread over the verification threads.
+ */
+class CCoinsPrefetch
+{
+private:
+    const CCoinsView *pview;
+    COutPoint outpoint;
+    Coin *pcoin;
+
+public:
+    CCoinsPrefetch(): pview(NULL), pcoin(NULL) {}
+    CCoinsPrefetch(const CCoinsView& viewIn, const COutPoint& outpointIn, Coin& coinIn) :
+        pview(&viewIn), outpoint(outpointIn), pcoin(&coinIn) { }
+
+    bool operator()();
+
+    void swap(CCoinsPrefetch &check) {
+        std::swap(pview, check.pview);
+        std::swap(outpoint, check.outpoint);
+        std::swap(pcoin, check.pcoin);
+    }
+};
+
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
@@ -520,6 +587,22 @@ public:
     bool VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview, int nCheckLevel, int nCheckDepth);
 };
 
+/** Replay blocks that aren't fully applied to the database. */
+bool ReplayBlocks(const CChainParams& params, CCoinsView* view);
+
+/**
+ * Write the coins of view as of snapshot to fileout as a UTXO snapshot, reading
+ * them with nParts threads, and return their MuHash in hashUTXOSet.
+ */
+bool DumpUTXOSnapshot(CAutoFile& fileout, const CCoinsViewDB& view, const CDBSnapshot& snapshot, int nParts, const CUTXOSnapshotMetadata& metadata, uint64_t& nCoins, uint256& hashUTXOSet);
+
+/**
+ * Load a UTXO snapshot written by DumpUTXOSnapshot into the empty chainstate, and make its base block the tip.
+ * The MuHash of its coins must equal hashExpected, which the caller has to get from a source it trusts;
+ * the checksum in the file only protects against corruption.
+ */
+bool LoadUTXOSnapshot(CValidationState& state, const CChainParams& chainparams, const boost::filesystem::path& path, const uint256& hashExpected, uint64_t& nCoins);
+
 /** Find the last common block between the parameter chain and a locator. */
 CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& locator);
 
@@ -535,6 +618,9 @@ bool ResetBlockFailureFlags(CBlockIndex *pindex);
 /** The currently-connected chain of blocks (protected by cs_main). */
 extern CChain chainActive;
 
+/** Global variable that points to the coins database (protected by cs_main) */
+extern CCoinsViewDB *pcoinsdbview;
+
 /** Global variable that points to the active CCoinsView (protected by cs_main) */
 extern CCoinsViewCache *pcoinsTip;
 
@@ -576,4 +662,10 @@ void DumpMempool();
 /** Load the mempool from disk. */
 bool LoadMempool();
 
+/** Dump the signature and script execution caches to disk. */
+void DumpSignatureCaches();
+
+/** Load the signature and script execution caches from disk. */
+bool LoadSignatureCaches();
+
 #endif // TCOIN_VALIDATION_H